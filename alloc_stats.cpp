@@ -0,0 +1,113 @@
+/**
+ * @file alloc_stats.cpp
+ * Contagem das alocações de memória de cada subsistema.
+ */
+
+#include "alloc_stats.h"
+
+const char *alloc_tag_names[ALLOC_TAG_COUNT] = {"other", "graph", "solver", "loader", "renderer"};
+
+#ifdef PRIM_ALLOC_STATS
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Guardado antes de cada bloco, para que a liberação saiba o tamanho e o tag.
+///
+/// Tem 16 bytes, para manter o alinhamento que o malloc garante.
+struct alignas(16) AllocHeader {
+    uint64_t size;
+    uint32_t tag;
+};
+
+struct AtomicAllocStats {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<int64_t> live_bytes{0};
+    std::atomic<int64_t> peak_bytes{0};
+};
+
+static AtomicAllocStats stats[ALLOC_TAG_COUNT];
+static thread_local AllocTag current_tag = ALLOC_OTHER;
+static thread_local uint64_t thread_allocations = 0;
+
+static void *allocate(size_t size) {
+    AllocHeader *header = (AllocHeader *)malloc(sizeof(AllocHeader) + size);
+    if (!header)
+        return nullptr;
+    header->size = size;
+    header->tag = current_tag;
+
+    AtomicAllocStats &s = stats[current_tag];
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = s.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = s.peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !s.peak_bytes.compare_exchange_weak(peak, live))
+        ;
+    thread_allocations++;
+    return header + 1;
+}
+
+static void deallocate(void *p) {
+    if (!p)
+        return;
+    AllocHeader *header = (AllocHeader *)p - 1;
+    stats[header->tag].live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+    free(header);
+}
+
+void *operator new(size_t size) {
+    void *p = allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void operator delete(void *p) noexcept { deallocate(p); }
+void operator delete[](void *p) noexcept { deallocate(p); }
+void operator delete(void *p, size_t) noexcept { deallocate(p); }
+void operator delete[](void *p, size_t) noexcept { deallocate(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { deallocate(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { deallocate(p); }
+
+AllocScope::AllocScope(AllocTag tag) : previous(current_tag) { current_tag = tag; }
+AllocScope::~AllocScope() { current_tag = previous; }
+
+AllocStats allocStats(AllocTag tag) {
+    const AtomicAllocStats &s = stats[tag];
+    return AllocStats{s.count.load(), s.bytes.load(), s.live_bytes.load(), s.peak_bytes.load()};
+}
+
+AllocStats allocTotal() {
+    AllocStats total = {};
+    for (int t = 0; t < ALLOC_TAG_COUNT; t++) {
+        AllocStats s = allocStats((AllocTag)t);
+        total.count += s.count;
+        total.bytes += s.bytes;
+        total.live_bytes += s.live_bytes;
+        // Os picos de cada tag podem ter acontecido em momentos diferentes.
+        total.peak_bytes += s.peak_bytes;
+    }
+    return total;
+}
+
+uint64_t threadAllocations() { return thread_allocations; }
+
+void printAllocReport() {
+    fprintf(stderr, "%-10s %10s %12s %12s %12s\n", "tag", "allocs", "bytes_kb", "live_kb",
+            "peak_kb");
+    for (int t = 0; t < ALLOC_TAG_COUNT; t++) {
+        AllocStats s = allocStats((AllocTag)t);
+        fprintf(stderr, "%-10s %10llu %12.1f %12.1f %12.1f\n", alloc_tag_names[t],
+                (unsigned long long)s.count, s.bytes / 1024.0, s.live_bytes / 1024.0,
+                s.peak_bytes / 1024.0);
+    }
+}
+
+#endif
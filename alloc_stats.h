@@ -0,0 +1,83 @@
+/**
+ * @file alloc_stats.h
+ * Contagem das alocações de memória de cada subsistema.
+ *
+ * Só existe quando compilado com PRIM_ALLOC_STATS (`make ALLOC_STATS=1`): o operator new global
+ * passa a contar, para cada AllocTag, as alocações, os bytes alocados e o pico de memória em uso.
+ * Cada alocação é atribuída ao ALLOC_SCOPE mais interno do thread que a fez, e a memória liberada
+ * é descontada do tag que a alocou. Sem PRIM_ALLOC_STATS, ALLOC_SCOPE não gera código.
+ *
+ * Só o operator new é contado; o que o driver OpenGL e as bibliotecas em C alocam com malloc fica
+ * de fora.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/// Os subsistemas aos quais as alocações são atribuídas.
+enum AllocTag {
+    /// Fora de qualquer ALLOC_SCOPE.
+    ALLOC_OTHER,
+    /// Criação do grafo (initGraph).
+    ALLOC_GRAPH,
+    /// Passos do prim.
+    ALLOC_SOLVER,
+    /// Leitura e processamento dos modelos.
+    ALLOC_LOADER,
+    /// Envio dos dados para a GPU e desenho dos quadros.
+    ALLOC_RENDERER,
+    ALLOC_TAG_COUNT
+};
+
+/// Nomes dos tags, na ordem de AllocTag.
+extern const char *alloc_tag_names[ALLOC_TAG_COUNT];
+
+/// Alocações de um tag.
+struct AllocStats {
+    uint64_t count;
+    uint64_t bytes;
+    /// Bytes alocados e ainda não liberados, e o maior valor que isso já teve.
+    int64_t live_bytes;
+    int64_t peak_bytes;
+};
+
+#ifdef PRIM_ALLOC_STATS
+
+const bool alloc_stats_enabled = true;
+
+/// Atribui ao tag `tag` as alocações do thread atual até o fim do escopo.
+class AllocScope {
+  public:
+    explicit AllocScope(AllocTag tag);
+    ~AllocScope();
+
+  private:
+    AllocTag previous;
+};
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+/// Atribui ao tag `tag` as alocações feitas até o fim do escopo atual.
+#define ALLOC_SCOPE(tag) AllocScope ALLOC_CONCAT(alloc_scope_, __LINE__)(tag)
+
+AllocStats allocStats(AllocTag tag);
+/// A soma de todos os tags.
+AllocStats allocTotal();
+
+/// Número de alocações feitas pelo thread atual desde o início.
+uint64_t threadAllocations();
+
+/// Imprime as alocações de cada tag na saída de erro.
+void printAllocReport();
+
+#else
+
+const bool alloc_stats_enabled = false;
+
+#define ALLOC_SCOPE(tag) ((void)0)
+
+inline uint64_t threadAllocations() { return 0; }
+inline void printAllocReport() {}
+
+#endif
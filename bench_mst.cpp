@@ -0,0 +1,242 @@
+/**
+ * @file bench_mst.cpp
+ * Mede o initGraph e o runPrimStep para vários tamanhos e distribuições de nós.
+ *
+ * Uso: `bench_mst [--min-n N] [--max-n N] [--budget S] [--distribution NOME] [--counters]
+ * [--huge-pages] [--out ARQUIVO]`.
+ *
+ * Para cada distribuição e cada N (1, 3, 10, 30... vezes 100, até `--max-n`), mede o tempo do
+ * initGraph e roda passos do prim até a árvore estar completa ou `--budget` segundos passarem.
+ * Como um passo é O(N), a árvore completa é O(N²): nos N grandes só os primeiros passos são
+ * medidos, e `complete` fica falso. Os resultados são escritos em JSON, na saída padrão ou em
+ * `--out`; o progresso vai para a saída de erro.
+ *
+ * Além dos tempos, cada resultado tem o tempo dos passos dividido pelo número de nós da fronteira
+ * que eles percorreram (`step_ns_per_n`) e o tempo da árvore dividido por N², que devem ficar
+ * constantes entre os tamanhos enquanto a complexidade não muda. Dividir pela fronteira, e não por
+ * N, faz os casos cortados pelo `--budget`, cujos passos percorrem quase N nós, serem comparáveis
+ * aos completos, cujos passos percorrem N/2 em média.
+ *
+ * Com `--counters`, os contadores do processador (veja hw_counters.h) são lidos em volta do
+ * initGraph e em volta dos passos do prim, para distinguir quando o prim é limitado pela memória,
+ * pelo processamento ou pelos desvios. Se eles não estiverem disponíveis, só os tempos são medidos.
+ *
+ * Com `--huge-pages`, os vetores do grafo usam páginas grandes (veja graph_arena.h).
+ */
+
+#include "graph.h"
+#include "hw_counters.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/// Resultado de um tamanho e uma distribuição.
+struct MstResult {
+    const char *distribution;
+    int count;
+    double init_ms;
+    /// Passos executados, e se eles completaram a árvore.
+    int steps;
+    bool complete;
+    double solve_ms;
+    /// Tempo de cada passo, em milissegundos.
+    SampleStats step;
+    /// Soma do tamanho da fronteira no início de cada passo: os nós que os passos percorreram.
+    double scanned;
+    /// Contadores do processador no initGraph e nos passos, se medidos.
+    bool has_counters;
+    HwSample init_counters;
+    HwSample solve_counters;
+};
+
+static const char *distribution_names[] = {"grid", "uniform", "clustered"};
+
+/// Mede um tamanho e uma distribuição. `counters` é nulo se os contadores não são lidos.
+static MstResult runCase(NodeDistribution distribution, int count, double budget_ms,
+                         HwCounters *counters) {
+    MstResult result = {};
+    result.distribution = distribution_names[distribution];
+    result.count = count;
+
+    // A mesma semente para cada caso, para que as medições sejam comparáveis entre execuções.
+    srand(1);
+    if (counters)
+        counters->start();
+    double start = perfNow();
+    initGraph(count, distribution);
+    result.init_ms = perfNow() - start;
+    if (counters)
+        result.init_counters = counters->stop();
+
+    std::vector<double> step_ms;
+    if (counters)
+        counters->start();
+    start = perfNow();
+    double now = start;
+    while (!not_included.empty() && now - start < budget_ms) {
+        double step_start = now;
+        result.scanned += not_included.size();
+        runPrimStep();
+        now = perfNow();
+        step_ms.push_back(now - step_start);
+    }
+    if (counters) {
+        result.solve_counters = counters->stop();
+        result.has_counters = true;
+    }
+    result.steps = step_ms.size();
+    result.complete = not_included.empty();
+    result.solve_ms = now - start;
+
+    result.step = sampleStats(step_ms);
+    return result;
+}
+
+/// Escreve os contadores de `sample` como um objeto JSON.
+static void writeCounters(FILE *out, const HwSample &sample) {
+    fprintf(out, "{");
+    for (int c = 0; c < HW_COUNTER_COUNT; c++) {
+        fprintf(out, "%s\"%s\": ", c > 0 ? ", " : "", hw_counter_names[c]);
+        if (sample.valid[c])
+            fprintf(out, "%llu", (unsigned long long)sample.value[c]);
+        else
+            fprintf(out, "null");
+    }
+    fprintf(out, "}");
+}
+
+static void writeJson(FILE *out, const std::vector<MstResult> &results, double budget_s) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"context\": {\n");
+    fprintf(out, "    \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(out, "    \"budget_s\": %g,\n", budget_s);
+    fprintf(out, "    \"huge_page_blocks\": %d,\n", graphArena().hugePageBlocks());
+    fprintf(out, "    \"compiler\": \"%s\"\n", __VERSION__);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const MstResult &r = results[i];
+        double n = r.count;
+        fprintf(out, "    {\"engine\": \"prim\", \"threads\": 1, \"distribution\": \"%s\", ",
+                r.distribution);
+        fprintf(out, "\"n\": %d, \"init_ms\": %.6f, \"steps\": %d, \"complete\": %s, ", r.count,
+                r.init_ms, r.steps, r.complete ? "true" : "false");
+        fprintf(out, "\"solve_ms\": %.6f, \"step_mean_ms\": %.6f, \"step_p50_ms\": %.6f, ",
+                r.solve_ms, r.step.mean, r.step.p50);
+        fprintf(out, "\"step_p99_ms\": %.6f, \"step_max_ms\": %.6f, ", r.step.p99, r.step.max);
+        fprintf(out, "\"step_ns_per_n\": %.6f, \"solve_ns_per_n2\": ",
+                r.step.mean * r.steps * 1e6 / r.scanned);
+        if (r.complete)
+            fprintf(out, "%.6f", r.solve_ms * 1e6 / (n * n));
+        else
+            fprintf(out, "null");
+        if (r.has_counters) {
+            fprintf(out, ", \"init_counters\": ");
+            writeCounters(out, r.init_counters);
+            fprintf(out, ", \"solve_counters\": ");
+            writeCounters(out, r.solve_counters);
+        }
+        fprintf(out, "}");
+        fprintf(out, "%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char **argv) {
+    int min_count = 100;
+    int max_count = 10000000;
+    double budget_s = 5.0;
+    int only_distribution = -1;
+    bool use_counters = false;
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-n") == 0 && i + 1 < argc) {
+            min_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-n") == 0 && i + 1 < argc) {
+            max_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget_s = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--distribution") == 0 && i + 1 < argc) {
+            i++;
+            for (int d = 0; d < 3; d++) {
+                if (strcmp(argv[i], distribution_names[d]) == 0)
+                    only_distribution = d;
+            }
+            if (only_distribution < 0) {
+                fprintf(stderr, "unknown distribution %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            use_counters = true;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            graphArena().setHugePages(true);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--min-n N] [--max-n N] [--budget SECONDS] "
+                    "[--distribution grid|uniform|clustered] [--counters] [--huge-pages] "
+                    "[--out FILE]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<int> counts;
+    for (long long decade = 100; decade <= max_count; decade *= 10) {
+        if (decade >= min_count)
+            counts.push_back(decade);
+        if (decade * 3 >= min_count && decade * 3 <= max_count)
+            counts.push_back(decade * 3);
+    }
+
+    HwCounters counters;
+    if (use_counters && !counters.init()) {
+        fprintf(stderr, "Hardware counters unavailable (no PMU, or perf_event_paranoid too high); "
+                        "measuring time only\n");
+        use_counters = false;
+    }
+
+    std::vector<MstResult> results;
+    for (int d = 0; d < 3; d++) {
+        if (only_distribution >= 0 && d != only_distribution)
+            continue;
+        for (int count : counts) {
+            MstResult r = runCase((NodeDistribution)d, count, budget_s * 1000.0,
+                                  use_counters ? &counters : NULL);
+            fprintf(stderr, "%-9s n=%-8d init %10.3f ms  %s %d steps in %10.3f ms  step %.4f ms",
+                    r.distribution, r.count, r.init_ms, r.complete ? "tree" : "partial", r.steps,
+                    r.solve_ms, r.step.mean);
+            if (r.has_counters) {
+                // Por passo, para comparar entre os tamanhos.
+                const HwSample &s = r.solve_counters;
+                if (s.ipc() >= 0.0)
+                    fprintf(stderr, "  ipc %.2f", s.ipc());
+                for (int c = HW_L1D_MISSES; c < HW_COUNTER_COUNT; c++) {
+                    if (s.valid[c])
+                        fprintf(stderr, "  %s/step %.1f", hw_counter_names[c],
+                                (double)s.value[c] / std::max(r.steps, 1));
+                }
+            }
+            fprintf(stderr, "\n");
+            results.push_back(r);
+        }
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+    writeJson(out, results, budget_s);
+    if (out != stdout)
+        fclose(out);
+    counters.destroy();
+    return 0;
+}
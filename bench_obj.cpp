@@ -0,0 +1,380 @@
+/**
+ * @file bench_obj.cpp
+ * Mede os leitores de OBJ com malhas sintéticas grandes.
+ *
+ * Uso: `bench_obj [--size MB] [--repeat N] [--dir DIR] [--keep] [--out ARQUIVO]`.
+ *
+ * Gera um OBJ de cerca de `--size` MB para cada combinação de MIXES (só posições ou também
+ * normais e coordenadas de textura, triângulos ou polígonos, comentários, quebras de linha CRLF),
+ * e lê cada um com o tinyobj::LoadObj, o tinyobj::ObjReader, o parseObjFile e o loadModel com
+ * cada ObjLoader, sem o cache. Cada leitura roda num processo separado, `--repeat` vezes, e são
+ * reportados o tempo mediano, a vazão em MB/s, o pico de memória residente do processo e quantas
+ * alocações (operator new) foram feitas, contadas pelo alloc_stats (o bench_obj é sempre compilado
+ * com PRIM_ALLOC_STATS).
+ */
+
+#include "alloc_stats.h"
+#include "model.h"
+#include "obj_parser.h"
+#include "perf.h"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/// O que um OBJ sintético contém.
+struct ObjMix {
+    const char *name;
+    bool normals;
+    bool texcoords;
+    /// Hexágonos cobrindo duas células da grade, em vez de dois triângulos por célula.
+    bool ngons;
+    /// Uma linha de comentário a cada 8 linhas.
+    bool comments;
+    bool crlf;
+};
+
+static const ObjMix MIXES[] = {
+    {"v-tri", false, false, false, false, false},
+    {"v-vn-vt-tri", true, true, false, false, false},
+    {"v-vn-ngon", true, false, true, false, false},
+    {"v-vn-vt-ngon-comments-crlf", true, true, true, true, true},
+};
+
+/// Os leitores medidos.
+enum BenchLoader {
+    BENCH_TINYOBJ_LOADOBJ,
+    BENCH_TINYOBJ_READER,
+    BENCH_PARSE_OBJ_FILE,
+    BENCH_LOAD_MODEL_FAST,
+    BENCH_LOAD_MODEL_PARALLEL,
+    BENCH_LOAD_MODEL_TINYOBJ,
+    BENCH_LOAD_MODEL_STREAMING,
+    BENCH_LOADER_COUNT,
+};
+
+static const char *loader_names[BENCH_LOADER_COUNT] = {
+    "tinyobj::LoadObj",   "tinyobj::ObjReader", "parseObjFile",
+    "loadModel fast",     "loadModel parallel", "loadModel tinyobj",
+    "loadModel streaming"};
+
+/// Escreve uma grade de `side` x `side` vértices, ondulada, no formato de `mix`.
+static void writeObj(FILE *out, const ObjMix &mix, int side) {
+    const char *eol = mix.crlf ? "\r\n" : "\n";
+    int lines = 0;
+    auto comment = [&]() {
+        if (mix.comments && ++lines % 8 == 0)
+            fprintf(out, "# linha %d, gerada pelo bench_obj%s", lines, eol);
+    };
+
+    fprintf(out, "# OBJ sintético: %s, %d x %d vértices%s", mix.name, side, side, eol);
+    fprintf(out, "o grade%s", eol);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            float h = 0.5f * sinf(0.1f * x) * cosf(0.1f * y);
+            fprintf(out, "v %.6f %.6f %.6f%s", (float)x, h, (float)y, eol);
+            comment();
+        }
+    }
+    if (mix.normals) {
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                float dx = -0.05f * cosf(0.1f * x) * cosf(0.1f * y);
+                float dy = 0.05f * sinf(0.1f * x) * sinf(0.1f * y);
+                float length = sqrtf(dx * dx + 1.0f + dy * dy);
+                fprintf(out, "vn %.6f %.6f %.6f%s", dx / length, 1.0f / length, dy / length, eol);
+                comment();
+            }
+        }
+    }
+    if (mix.texcoords) {
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                fprintf(out, "vt %.6f %.6f%s", (float)x / side, (float)y / side, eol);
+                comment();
+            }
+        }
+    }
+
+    // Um índice de vértice, com a normal e a coordenada de textura de mesmo índice.
+    auto corner = [&](int x, int y) {
+        int i = y * side + x + 1;
+        if (mix.normals && mix.texcoords)
+            fprintf(out, " %d/%d/%d", i, i, i);
+        else if (mix.normals)
+            fprintf(out, " %d//%d", i, i);
+        else if (mix.texcoords)
+            fprintf(out, " %d/%d", i, i);
+        else
+            fprintf(out, " %d", i);
+    };
+    for (int y = 0; y + 1 < side; y++) {
+        int x = 0;
+        if (mix.ngons) {
+            for (; x + 2 < side; x += 2) {
+                fputc('f', out);
+                corner(x, y);
+                corner(x, y + 1);
+                corner(x + 1, y + 1);
+                corner(x + 2, y + 1);
+                corner(x + 2, y);
+                corner(x + 1, y);
+                fputs(eol, out);
+                comment();
+            }
+        }
+        for (; x + 1 < side; x++) {
+            fputc('f', out);
+            corner(x, y);
+            corner(x, y + 1);
+            corner(x + 1, y + 1);
+            fputs(eol, out);
+            fputc('f', out);
+            corner(x, y);
+            corner(x + 1, y + 1);
+            corner(x + 1, y);
+            fputs(eol, out);
+            comment();
+        }
+    }
+}
+
+/// Gera em `path` um OBJ de cerca de `target_bytes` no formato de `mix`.
+///
+/// @return o tamanho do arquivo, ou 0 se ele não pôde ser escrito.
+static size_t generateObj(const char *path, const ObjMix &mix, size_t target_bytes) {
+    // Estima o tamanho de cada vértice com uma grade pequena.
+    const int SAMPLE_SIDE = 64;
+    FILE *sample = tmpfile();
+    if (!sample)
+        return 0;
+    writeObj(sample, mix, SAMPLE_SIDE);
+    double bytes_per_vertex = (double)ftell(sample) / (SAMPLE_SIDE * SAMPLE_SIDE);
+    fclose(sample);
+    int side = std::max(2, (int)sqrt(target_bytes / bytes_per_vertex));
+
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return 0;
+    static char buffer[1 << 20];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+    writeObj(out, mix, side);
+    size_t size = ftell(out);
+    if (fclose(out) != 0)
+        return 0;
+    return size;
+}
+
+/// Resultado de uma leitura.
+struct LoadResult {
+    bool ok;
+    double ms;
+    /// Vértices lidos, para conferir que os leitores concordam.
+    size_t vertices;
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    /// Memória residente antes da leitura e o pico do processo, em KB (0 se desconhecido).
+    long base_rss_kb;
+    long peak_rss_kb;
+};
+
+/// Memória residente atual do processo, em KB, ou 0 se desconhecida.
+static long currentRssKb() {
+    long rss = 0;
+#ifdef __linux__
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status)
+        return 0;
+    char line[256];
+    while (fgets(line, sizeof(line), status)) {
+        if (sscanf(line, "VmRSS: %ld kB", &rss) == 1)
+            break;
+    }
+    fclose(status);
+#endif
+    return rss;
+}
+
+/// Lê `path` com `loader`, medindo o tempo e as alocações.
+static LoadResult runLoader(BenchLoader loader, const char *path) {
+    LoadResult result = {};
+    result.base_rss_kb = currentRssKb();
+    AllocStats before = allocTotal();
+
+    double start = perfNow();
+    if (loader <= BENCH_PARSE_OBJ_FILE) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        // Os dados continuam no reader até o fim do escopo, como no loadModel.
+        tinyobj::ObjReader reader;
+        if (loader == BENCH_TINYOBJ_LOADOBJ) {
+            result.ok = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path);
+        } else if (loader == BENCH_TINYOBJ_READER) {
+            result.ok = reader.ParseFromFile(path);
+        } else {
+            result.ok = parseObjFile(path, attrib, shapes, err);
+        }
+        result.ms = perfNow() - start;
+        const tinyobj::attrib_t &read =
+            loader == BENCH_TINYOBJ_READER ? reader.GetAttrib() : attrib;
+        result.vertices = read.vertices.size() / 3;
+    } else {
+        ObjLoader obj_loader = (ObjLoader)(OBJ_LOADER_FAST + loader - BENCH_LOAD_MODEL_FAST);
+        Mesh mesh = loadModel(path, obj_loader, false);
+        result.ms = perfNow() - start;
+        result.ok = mesh.vertexCount() > 0;
+        result.vertices = mesh.vertexCount();
+    }
+    AllocStats after = allocTotal();
+    result.allocations = after.count - before.count;
+    result.allocated_bytes = after.bytes - before.bytes;
+
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_kb = usage.ru_maxrss;
+#endif
+    return result;
+}
+
+/// Roda runLoader num processo filho, para que o pico de memória seja só o dessa leitura.
+static LoadResult measure(BenchLoader loader, const char *path) {
+#ifdef _WIN32
+    return runLoader(loader, path);
+#else
+    int fds[2];
+    if (pipe(fds) != 0)
+        return LoadResult{};
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        // O loadModel imprime estatísticas do modelo.
+        if (!freopen("/dev/null", "w", stdout))
+            _exit(1);
+        LoadResult result = runLoader(loader, path);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    LoadResult result = {};
+    if (pid < 0 || read(fds[0], &result, sizeof(result)) != sizeof(result))
+        result.ok = false;
+    close(fds[0]);
+    if (pid > 0)
+        waitpid(pid, NULL, 0);
+    return result;
+#endif
+}
+
+int main(int argc, char **argv) {
+    double size_mb = 16.0;
+    int repeat = 3;
+    std::string dir;
+    bool keep = false;
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size_mb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--size MB] [--repeat N] [--dir DIR] [--keep] [--out FILE]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (dir.empty()) {
+        const char *tmp = getenv("TMPDIR");
+        dir = tmp ? tmp : "/tmp";
+    }
+
+    FILE *json = NULL;
+    if (out_path) {
+        json = fopen(out_path, "w");
+        if (!json) {
+            perror(out_path);
+            return 1;
+        }
+        fprintf(json, "{\n  \"size_mb\": %g,\n  \"repeat\": %d,\n  \"results\": [\n", size_mb,
+                repeat);
+    }
+
+    printf("%-28s %9s %-20s %10s %9s %10s %10s %10s %10s\n", "mix", "file_mb", "loader", "ms",
+           "MB/s", "allocs", "alloc_mb", "peak_mb", "vertices");
+    bool first = true;
+    for (const ObjMix &mix : MIXES) {
+        std::string path = dir + "/bench_obj_" + mix.name + ".obj";
+        size_t file_bytes = generateObj(path.c_str(), mix, (size_t)(size_mb * 1024 * 1024));
+        if (file_bytes == 0) {
+            fprintf(stderr, "Could not write %s\n", path.c_str());
+            return 1;
+        }
+        double file_mb = file_bytes / (1024.0 * 1024.0);
+
+        for (int l = 0; l < BENCH_LOADER_COUNT; l++) {
+            std::vector<double> times;
+            LoadResult result = {};
+            long peak_rss_kb = 0;
+            for (int r = 0; r < repeat; r++) {
+                result = measure((BenchLoader)l, path.c_str());
+                if (!result.ok)
+                    break;
+                times.push_back(result.ms);
+                peak_rss_kb = std::max(peak_rss_kb, result.peak_rss_kb);
+            }
+            if (!result.ok) {
+                printf("%-28s %9.2f %-20s %10s\n", mix.name, file_mb, loader_names[l], "failed");
+                continue;
+            }
+            double ms = sampleStats(times).p50;
+            printf("%-28s %9.2f %-20s %10.2f %9.1f %10llu %10.2f %10.2f %10zu\n", mix.name,
+                   file_mb, loader_names[l], ms, file_mb / (ms / 1000.0),
+                   (unsigned long long)result.allocations,
+                   result.allocated_bytes / (1024.0 * 1024.0), peak_rss_kb / 1024.0,
+                   result.vertices);
+            fflush(stdout);
+
+            if (json) {
+                fprintf(json,
+                        "%s    {\"mix\": \"%s\", \"file_bytes\": %zu, \"loader\": \"%s\", "
+                        "\"ms\": %.4f, \"mb_per_s\": %.3f, \"allocations\": %llu, "
+                        "\"allocated_bytes\": %llu, \"base_rss_kb\": %ld, \"peak_rss_kb\": %ld, "
+                        "\"vertices\": %zu}",
+                        first ? "" : ",\n", mix.name, file_bytes, loader_names[l], ms,
+                        file_mb / (ms / 1000.0), (unsigned long long)result.allocations,
+                        (unsigned long long)result.allocated_bytes, result.base_rss_kb,
+                        peak_rss_kb, result.vertices);
+                first = false;
+            }
+        }
+        if (!keep)
+            remove(path.c_str());
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+    return 0;
+}
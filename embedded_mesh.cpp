@@ -0,0 +1,30 @@
+/**
+ * @file embedded_mesh.cpp
+ * Modelos embutidos no executável.
+ */
+
+#include "embedded_mesh.h"
+
+#include <string.h>
+
+// O header é gerado pelo Makefile; sem ele, nenhum modelo é embutido.
+#if __has_include("embedded_meshes.h")
+#include "embedded_meshes.h"
+#else
+static const EmbeddedMesh *const embedded_meshes = nullptr;
+static const size_t embedded_mesh_count = 0;
+#endif
+
+bool openEmbeddedMesh(const char *name, Mesh &mesh) {
+    for (size_t i = 0; i < embedded_mesh_count; i++) {
+        const EmbeddedMesh &embedded = embedded_meshes[i];
+        if (strcmp(embedded.name, name) != 0)
+            continue;
+
+        mesh.setStatic(embedded.vertices, embedded.vertex_count, embedded.indices,
+                       embedded.index_count, embedded.index_size);
+        mesh.setLods(std::vector<MeshLod>(embedded.lods, embedded.lods + embedded.lod_count));
+        return true;
+    }
+    return false;
+}
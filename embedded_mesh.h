@@ -0,0 +1,32 @@
+/**
+ * @file embedded_mesh.h
+ * Modelos embutidos no executável.
+ *
+ * O Makefile converte os OBJ de EMBEDDED_OBJS com o obj2cpp em arrays constexpr, no header
+ * gerado `embedded_meshes.h`, já processados como pelo loadModel. Assim eles são desenhados sem
+ * ler nenhum arquivo, de qualquer diretório.
+ */
+
+#pragma once
+
+#include "model.h"
+
+#include <stddef.h>
+
+/// Um modelo embutido, gerado pelo obj2cpp.
+struct EmbeddedMesh {
+    /// Caminho do OBJ de onde o modelo foi gerado.
+    const char *name;
+    const float *vertices;
+    size_t vertex_count;
+    const void *indices;
+    size_t index_count;
+    size_t index_size;
+    const MeshLod *lods;
+    size_t lod_count;
+};
+
+/// Usa o modelo embutido gerado a partir do OBJ `name`, se houver.
+///
+/// @return false se nenhum modelo foi embutido com esse nome.
+bool openEmbeddedMesh(const char *name, Mesh &mesh);
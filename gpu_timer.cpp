@@ -0,0 +1,137 @@
+/**
+ * @file gpu_timer.cpp
+ * Medição do tempo de GPU de cada passe de renderização.
+ */
+
+#include "gpu_timer.h"
+#include "trace.h"
+
+#include <algorithm>
+
+const char *render_pass_names[PASS_COUNT] = {"edges", "ground", "nodes"};
+
+void GpuTimers::init() {
+    for (Slot &slot : slots) {
+        glGenQueries(PASS_COUNT, slot.queries);
+        std::fill(slot.used, slot.used + PASS_COUNT, false);
+        slot.frame = -1;
+    }
+    for (int pass = 0; pass < PASS_COUNT; pass++) {
+        windows[pass].clear();
+        history[pass].clear();
+    }
+    current = 0;
+    frame = 0;
+    frames_collected = 0;
+    initialized = true;
+}
+
+void GpuTimers::destroy() {
+    if (!initialized)
+        return;
+    for (Slot &slot : slots) {
+        glDeleteQueries(PASS_COUNT, slot.queries);
+    }
+    initialized = false;
+}
+
+void GpuTimers::keepHistory(bool keep, int frames) {
+    keep_history = keep;
+    for (int pass = 0; pass < PASS_COUNT; pass++) {
+        history[pass].reserve(frames);
+    }
+}
+
+void GpuTimers::beginFrame() {
+    if (!initialized)
+        return;
+    Slot &slot = slots[current];
+    if (slot.frame != -1)
+        collect(slot, false);
+    slot.frame = frame;
+}
+
+void GpuTimers::endFrame() {
+    if (!initialized)
+        return;
+    current = (current + 1) % RING_SIZE;
+    frame++;
+}
+
+void GpuTimers::begin(RenderPass pass) {
+    if (!initialized)
+        return;
+    slots[current].submitted_ms[pass] = perfNow();
+    GL_COUNTED(glBeginQuery(GL_TIME_ELAPSED, slots[current].queries[pass]));
+}
+
+void GpuTimers::end(RenderPass pass) {
+    if (!initialized)
+        return;
+    GL_COUNTED(glEndQuery(GL_TIME_ELAPSED));
+    slots[current].used[pass] = true;
+}
+
+void GpuTimers::flush() {
+    if (!initialized)
+        return;
+    for (int i = 0; i < RING_SIZE; i++) {
+        Slot &slot = slots[(current + i) % RING_SIZE];
+        if (slot.frame != -1)
+            collect(slot, true);
+    }
+}
+
+void GpuTimers::collect(Slot &slot, bool wait) {
+    // A GPU só dá a duração de cada passe. No trace, os passes de um quadro ficam um depois do
+    // outro: cada um começa quando foi enviado ou quando o anterior terminou, o que vier depois.
+    double gpu_end = 0.0;
+    for (int pass = 0; pass < PASS_COUNT; pass++) {
+        if (!slot.used[pass])
+            continue;
+        slot.used[pass] = false;
+
+        GLint available = 0;
+        GL_COUNTED(glGetQueryObjectiv(slot.queries[pass], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available && !wait) {
+            record(pass, slot.frame, -1.0);
+            continue;
+        }
+
+        GLuint64 elapsed = 0;
+        GL_COUNTED(glGetQueryObjectui64v(slot.queries[pass], GL_QUERY_RESULT, &elapsed));
+        double ms = elapsed / 1e6;
+        record(pass, slot.frame, ms);
+        double gpu_start = std::max(slot.submitted_ms[pass], gpu_end);
+        gpu_end = gpu_start + ms;
+        TRACE_TRACK_EVENT("GPU", render_pass_names[pass], gpu_start, gpu_end);
+    }
+    slot.frame = -1;
+    frames_collected++;
+}
+
+void GpuTimers::record(int pass, int frame, double ms) {
+    if (keep_history) {
+        if ((int)history[pass].size() <= frame)
+            history[pass].resize(frame + 1, -1.0);
+        history[pass][frame] = ms;
+    }
+    if (ms < 0)
+        return;
+
+    windows[pass].add(ms);
+}
+
+TimerStats GpuTimers::stats(RenderPass pass) const {
+    SampleStats s = windows[pass].stats();
+    return TimerStats{s.mean, s.p50, s.p95, s.p99, windows[pass].samples()};
+}
+
+void GpuTimers::print(FILE *out) const {
+    fprintf(out, "GPU time (ms, last %d frames):\n", GpuTimers::WINDOW);
+    for (int pass = 0; pass < PASS_COUNT; pass++) {
+        TimerStats s = stats((RenderPass)pass);
+        fprintf(out, "  %-8s mean %8.4f  p50 %8.4f  p95 %8.4f  p99 %8.4f  (%d samples)\n",
+                render_pass_names[pass], s.mean, s.p50, s.p95, s.p99, s.samples);
+    }
+}
@@ -0,0 +1,94 @@
+/**
+ * @file gpu_timer.h
+ * Medição do tempo de GPU de cada passe de renderização.
+ */
+
+#pragma once
+
+#include "perf.h"
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <vector>
+
+/// Os passes de renderização medidos.
+enum RenderPass { PASS_EDGES, PASS_GROUND, PASS_NODES, PASS_COUNT };
+
+/// Nomes dos passes, na ordem de RenderPass.
+extern const char *render_pass_names[PASS_COUNT];
+
+/// Estatísticas de tempo de um passe, em milissegundos.
+struct TimerStats {
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    int samples;
+};
+
+/// Consultas GL_TIME_ELAPSED em volta de cada passe.
+///
+/// As consultas formam um anel de RING_SIZE quadros. O resultado de um quadro só é lido quando o
+/// seu slot vai ser reutilizado e, se ainda não estiver disponível, é descartado em vez de
+/// bloquear a CPU.
+///
+/// Com PRIM_TRACE, cada tempo lido também vai para a trilha "GPU" do trace (veja trace.h).
+class GpuTimers {
+  public:
+    /// Número de amostras usadas nas médias móveis e percentis.
+    static constexpr int WINDOW = TimeWindow::SIZE;
+
+    void init();
+    void destroy();
+
+    /// Começa um quadro, lendo os resultados do quadro que ocupava o slot.
+    void beginFrame();
+    void endFrame();
+
+    void begin(RenderPass pass);
+    void end(RenderPass pass);
+
+    /// Lê todos os resultados pendentes, esperando por eles.
+    void flush();
+
+    /// Guarda o tempo de cada quadro em `history`, para relatórios quadro a quadro, reservando
+    /// espaço para `frames` quadros.
+    void keepHistory(bool keep, int frames = 0);
+
+    /// Estatísticas das últimas WINDOW amostras do passe.
+    TimerStats stats(RenderPass pass) const;
+
+    /// Imprime as estatísticas de todos os passes.
+    void print(FILE *out) const;
+
+    /// Número de quadros cujos resultados já foram lidos.
+    int collected() const { return frames_collected; }
+
+    /// Tempo, em milissegundos, de cada passe em cada quadro (se keepHistory(true)), ou -1 se o
+    /// resultado foi descartado.
+    std::vector<double> history[PASS_COUNT];
+
+  private:
+    static const int RING_SIZE = 4;
+
+    struct Slot {
+        unsigned int queries[PASS_COUNT];
+        bool used[PASS_COUNT];
+        /// Tempo de perfNow() em que cada passe foi enviado.
+        double submitted_ms[PASS_COUNT];
+        int frame;
+    };
+
+    Slot slots[RING_SIZE];
+    int current = 0;
+    int frame = 0;
+    int frames_collected = 0;
+    bool keep_history = false;
+    bool initialized = false;
+
+    /// As últimas amostras de cada passe.
+    TimeWindow windows[PASS_COUNT];
+
+    void collect(Slot &slot, bool wait);
+    void record(int pass, int frame, double ms);
+};
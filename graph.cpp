@@ -0,0 +1,160 @@
+/**
+ * @file graph.cpp
+ * O grafo de nós e o algoritmo de Prim que constrói a sua árvore geradora mínima.
+ */
+
+#include "graph.h"
+#include "alloc_stats.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+ArenaVector<Node> nodes;
+ArenaVector<int> not_included;
+int last_added = -1;
+
+QuadTree node_tree;
+glm::vec3 node_origin;
+glm::vec3 node_extent;
+
+TimeWindow step_times;
+
+/// Posições dos nós passadas ao node_tree, que guarda a sua própria cópia.
+static std::vector<glm::vec3> node_positions;
+
+/// Número aleatório uniforme em [0, 1].
+static float randomUnit() { return (float)rand() / (float)(RAND_MAX); }
+
+/// Número aleatório com distribuição normal padrão (Box-Muller).
+static float randomNormal() {
+    float u = std::max(randomUnit(), 1e-7f);
+    float v = randomUnit();
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+void initGraph(int count, NodeDistribution distribution) {
+    TRACE_SCOPE("initGraph");
+    ALLOC_SCOPE(ALLOC_GRAPH);
+    // Lado da grade; as outras distribuições ocupam o mesmo quadrado, [-side, side].
+    int side = (int)ceil(sqrt((double)count));
+
+    // Nada mais aponta para a arena, então ela pode ser reaproveitada inteira.
+    nodes = ArenaVector<Node>();
+    not_included = ArenaVector<int>();
+    graphArena().reset();
+    nodes.reserve(count);
+    not_included.reserve(count);
+
+    ArenaVector<glm::vec2> centers;
+    float spread = 0.0f;
+    if (distribution == NODE_DISTRIBUTION_CLUSTERED) {
+        int clusters = std::max(1, count / 100);
+        for (int c = 0; c < clusters; c++) {
+            float x = side * (2.0f * randomUnit() - 1.0f);
+            float z = side * (2.0f * randomUnit() - 1.0f);
+            centers.push_back(glm::vec2(x, z));
+        }
+        spread = 0.5f * sqrtf((float)count / clusters);
+    }
+
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position;
+        if (distribution == NODE_DISTRIBUTION_GRID) {
+            int x = i / side;
+            int y = i % side;
+            float dx = 1.0 * ((float)rand() / (float)(RAND_MAX)-1.0);
+            float dy = 1.0 * ((float)rand() / (float)(RAND_MAX)-1.0);
+            position = glm::vec3((float)x * 2.0f - (side - 1) + dx, 0.0f,
+                                 -(side - 1) + 2.0f * (float)y + dy);
+        } else if (distribution == NODE_DISTRIBUTION_UNIFORM) {
+            float x = side * (2.0f * randomUnit() - 1.0f);
+            float z = side * (2.0f * randomUnit() - 1.0f);
+            position = glm::vec3(x, 0.0f, z);
+        } else {
+            glm::vec2 center = centers[rand() % centers.size()];
+            float x = center.x + spread * randomNormal();
+            float z = center.y + spread * randomNormal();
+            position = glm::vec3(x, 0.0f, z);
+        }
+        nodes.push_back(
+            Node{.position = position, .in_tree = false, .connected_to = -1, .cost = 1.0f / 0.0f});
+    }
+    not_included.resize(nodes.size());
+    for (int v = 0; v < nodes.size(); v++) {
+        not_included[v] = v;
+    }
+    for (int i = 0; i < nodes.size() - 1; i++) {
+        int r = i + (rand() % (not_included.size() - i));
+        std::swap(not_included[i], not_included[r]);
+    }
+    last_added = -1;
+
+    node_positions.clear();
+    node_origin = nodes[0].position;
+    glm::vec3 node_max = nodes[0].position;
+    for (auto &node : nodes) {
+        node_positions.push_back(node.position);
+        node_origin = glm::min(node_origin, node.position);
+        node_max = glm::max(node_max, node.position);
+    }
+    // Evita dividir por zero quando todos os nós têm a mesma coordenada num eixo.
+    node_extent = glm::max(node_max - node_origin, glm::vec3(1e-6f));
+    node_tree.build(node_positions, NODE_RADIUS, NODE_HEIGHT);
+}
+
+/// beseado em: https://en.wikipedia.org/wiki/Prim%27s_algorithm#Description
+void runPrimStep() {
+    TRACE_SCOPE("runPrimStep");
+    ALLOC_SCOPE(ALLOC_SOLVER);
+    double start = perf_enabled ? perfNow() : 0.0;
+
+    if (!not_included.empty()) {
+        float min_cost = 1.0f / 0.0f;
+        int min = -1;
+        for (int i = 0; i < not_included.size(); i++) {
+            int v = not_included[i];
+            if (min == -1 || nodes[v].cost < min_cost) {
+                min_cost = nodes[v].cost;
+                min = i;
+            }
+        }
+        int v = not_included[min];
+        not_included.erase(not_included.begin() + min);
+        nodes[v].in_tree = true;
+        last_added = v;
+
+        if (nodes[v].connected_to != -1) {
+            float reach = glm::distance(nodes[v].position, nodes[nodes[v].connected_to].position);
+            node_tree.setReach(v, reach);
+        }
+
+        for (int w : not_included) {
+            float new_cost = glm::distance(nodes[v].position, nodes[w].position);
+            if (new_cost < nodes[w].cost) {
+                nodes[w].connected_to = v;
+                nodes[w].cost = new_cost;
+            }
+        }
+    } else {
+        last_added = -1;
+    }
+
+    if (perf_enabled) {
+        step_times.add(perfNow() - start);
+    }
+}
+
+int runPrimSteps(double budget_ms) {
+    TRACE_SCOPE("runPrimSteps");
+    double start = perfNow();
+    int steps = 0;
+    while (!not_included.empty()) {
+        runPrimStep();
+        steps++;
+        if (perfNow() - start >= budget_ms)
+            break;
+    }
+    return steps;
+}
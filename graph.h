@@ -0,0 +1,72 @@
+/**
+ * @file graph.h
+ * O grafo de nós e o algoritmo de Prim que constrói a sua árvore geradora mínima.
+ *
+ * Não usa o OpenGL, para poder ser medido separadamente da visualização (veja bench_mst.cpp).
+ */
+
+#pragma once
+
+#include "graph_arena.h"
+#include "perf.h"
+#include "spatial.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/// Um nó no grafo
+struct Node {
+    /// A posição do grafo
+    glm::vec3 position;
+
+    /// Se esse nó já foi adicionado a árvore.
+    bool in_tree;
+
+    /// O indice do nó na árvore mais próximo deste.
+    int connected_to;
+    /// A distância ao nó na árvore mais próximo deste.
+    float cost;
+};
+
+/// Como as posições dos nós são sorteadas.
+enum NodeDistribution {
+    /// Uma grade quadrada com espaçamento 2, com cada nó deslocado aleatoriamente.
+    NODE_DISTRIBUTION_GRID,
+    /// Uniforme no mesmo quadrado da grade.
+    NODE_DISTRIBUTION_UNIFORM,
+    /// Grupos com distribuição normal em volta de centros uniformes no mesmo quadrado.
+    NODE_DISTRIBUTION_CLUSTERED,
+};
+
+/// Todos os nós do grafo.
+extern ArenaVector<Node> nodes;
+/// Os nós ainda não incluídos na árvore mínima.
+extern ArenaVector<int> not_included;
+/// O indice do último nó adicionado à àrvore mínima.
+extern int last_added;
+
+/// Índice espacial sobre as posições dos nós, usado para descartar o que está fora da câmera.
+extern QuadTree node_tree;
+/// Canto mínimo e tamanho da caixa que contém todos os nós.
+extern glm::vec3 node_origin;
+extern glm::vec3 node_extent;
+/// Meia-largura e altura da casinha desenhada em cada nó.
+const float NODE_RADIUS = 0.25f;
+const float NODE_HEIGHT = 0.75f;
+
+/// Tempo de cada passo do prim, coletado quando `perf_enabled` é verdadeiro.
+extern TimeWindow step_times;
+
+/// Reseta o gráfo para o estado inicial, com `count` nós sorteados conforme `distribution`.
+///
+/// Os vetores do grafo são recriados na graphArena(), reaproveitando a memória do grafo anterior.
+void initGraph(int count = 25, NodeDistribution distribution = NODE_DISTRIBUTION_GRID);
+
+/// Roda uma iteração do algoritmo Prim.
+void runPrimStep();
+
+/// Roda iterações do prim até a árvore estar completa ou passarem `budget_ms` milissegundos,
+/// executando ao menos uma.
+///
+/// @return o número de iterações executadas.
+int runPrimSteps(double budget_ms);
@@ -0,0 +1,127 @@
+/**
+ * @file graph_arena.cpp
+ * A memória dos vetores do grafo, reaproveitada a cada initGraph.
+ */
+
+#include "graph_arena.h"
+
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+GraphArena &graphArena() {
+    static GraphArena *arena = new GraphArena();
+    return *arena;
+}
+
+/// Menor bloco alocado, para que vetores pequenos não criem um bloco cada.
+static const size_t MIN_BLOCK_SIZE = 64 * 1024;
+/// Tamanho das páginas grandes, e o menor bloco que vale a pena alocar com elas.
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+GraphArena::~GraphArena() {
+    for (const Block &block : blocks)
+        freeBlock(block);
+}
+
+void *GraphArena::allocate(size_t bytes, size_t align) {
+    if (!blocks.empty()) {
+        const Block &block = blocks.back();
+        size_t start = (offset + align - 1) & ~(align - 1);
+        if (start + bytes <= block.size) {
+            offset = start + bytes;
+            return block.data + start;
+        }
+    }
+    addBlock(bytes);
+    offset = bytes;
+    return blocks.back().data;
+}
+
+void GraphArena::deallocate(void *p, size_t bytes) {
+    if (!blocks.empty() && (char *)p + bytes == blocks.back().data + offset)
+        offset -= bytes;
+}
+
+void GraphArena::reset() {
+    if (blocks.size() > 1) {
+        size_t total = capacity();
+        for (const Block &block : blocks)
+            freeBlock(block);
+        blocks.clear();
+        addBlock(total);
+    }
+    offset = 0;
+    used_before = 0;
+}
+
+size_t GraphArena::capacity() const {
+    size_t total = 0;
+    for (const Block &block : blocks)
+        total += block.size;
+    return total;
+}
+
+size_t GraphArena::used() const { return used_before + offset; }
+
+int GraphArena::hugePageBlocks() const {
+    int count = 0;
+    for (const Block &block : blocks)
+        count += block.kind != BLOCK_HEAP;
+    return count;
+}
+
+/// Adiciona um bloco com pelo menos `min_size` bytes e pelo menos a capacidade atual, que assim
+/// dobra, para que um vetor que cresce não crie um bloco a cada realocação.
+void GraphArena::addBlock(size_t min_size) {
+    size_t size = capacity();
+    if (size < min_size)
+        size = min_size;
+    if (size < MIN_BLOCK_SIZE)
+        size = MIN_BLOCK_SIZE;
+    used_before += offset;
+    offset = 0;
+
+#ifdef __linux__
+    if (huge_pages && size >= HUGE_PAGE_SIZE) {
+        size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        void *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            blocks.push_back(Block{(char *)data, size, BLOCK_HUGETLB});
+            return;
+        }
+        // Sem páginas grandes reservadas: pede páginas grandes transparentes, que só cobrem
+        // regiões alinhadas a 2 MB.
+        if (posix_memalign(&data, HUGE_PAGE_SIZE, size) == 0) {
+            madvise(data, size, MADV_HUGEPAGE);
+            blocks.push_back(Block{(char *)data, size, BLOCK_TRANSPARENT});
+            return;
+        }
+    }
+#endif
+
+    blocks.push_back(Block{(char *)::operator new(size), size, BLOCK_HEAP});
+}
+
+void GraphArena::freeBlock(const Block &block) {
+    switch (block.kind) {
+    case BLOCK_HEAP:
+        ::operator delete(block.data);
+        break;
+#ifdef __linux__
+    case BLOCK_HUGETLB:
+        munmap(block.data, block.size);
+        break;
+    case BLOCK_TRANSPARENT:
+        free(block.data);
+        break;
+#endif
+    default:
+        break;
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * @file graph_arena.h
+ * A memória dos vetores do grafo, reaproveitada a cada initGraph.
+ *
+ * Os vetores do grafo (ArenaVector) alocam de blocos contíguos, avançando um ponteiro, e liberar
+ * memória não faz nada, exceto quando é a última alocação. No início de cada initGraph os vetores
+ * são esvaziados e reset() devolve a arena inteira de uma vez, mantendo os blocos, então os novos
+ * vetores ocupam a mesma memória que os anteriores em vez de voltar ao heap. Se um grafo maior
+ * precisou de mais de um bloco, o reset os junta num só, do tamanho da soma.
+ *
+ * Com setHugePages, os blocos grandes são alocados com páginas de 2 MB: no Linux, com MAP_HUGETLB
+ * se houver páginas grandes reservadas (`/proc/sys/vm/nr_hugepages`), ou com madvise(MADV_HUGEPAGE)
+ * para o kernel usar páginas grandes transparentes. Fora do Linux a opção é ignorada.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+class GraphArena {
+  public:
+    GraphArena() = default;
+    GraphArena(const GraphArena &) = delete;
+    GraphArena &operator=(const GraphArena &) = delete;
+    ~GraphArena();
+
+    /// Aloca `bytes` com alinhamento `align` (no máximo 16).
+    void *allocate(size_t bytes, size_t align);
+    /// Devolve a memória se ela for a última alocação do bloco atual; senão não faz nada.
+    void deallocate(void *p, size_t bytes);
+
+    /// Devolve toda a memória alocada. Nada alocado antes pode continuar em uso.
+    void reset();
+
+    /// Usa páginas grandes nos blocos alocados a partir de agora.
+    void setHugePages(bool enabled) { huge_pages = enabled; }
+
+    /// Memória reservada pelos blocos e a parte dela em uso, em bytes.
+    size_t capacity() const;
+    size_t used() const;
+    /// Quantos blocos usam páginas grandes.
+    int hugePageBlocks() const;
+
+  private:
+    enum BlockKind {
+        /// Alocado com operator new (contado pelo alloc_stats).
+        BLOCK_HEAP,
+        /// Alocado com mmap e MAP_HUGETLB.
+        BLOCK_HUGETLB,
+        /// Alinhado a 2 MB, com madvise(MADV_HUGEPAGE).
+        BLOCK_TRANSPARENT,
+    };
+
+    struct Block {
+        char *data;
+        size_t size;
+        BlockKind kind;
+    };
+
+    /// Os blocos, com as alocações sempre no último.
+    std::vector<Block> blocks;
+    /// Bytes usados do último bloco, e a soma do que foi usado nos anteriores.
+    size_t offset = 0;
+    size_t used_before = 0;
+    bool huge_pages = false;
+
+    void addBlock(size_t min_size);
+    void freeBlock(const Block &block);
+};
+
+/// A arena de todos os vetores do grafo.
+///
+/// Nunca é destruída, para continuar válida enquanto os destrutores dos vetores globais rodam na
+/// saída do programa, qualquer que seja a ordem deles.
+GraphArena &graphArena();
+
+/// Alocador que usa a graphArena().
+template <typename T> struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    template <typename U> ArenaAllocator(const ArenaAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return (T *)graphArena().allocate(n * sizeof(T), alignof(T) < 16 ? alignof(T) : 16);
+    }
+    void deallocate(T *p, size_t n) { graphArena().deallocate(p, n * sizeof(T)); }
+
+    template <typename U> bool operator==(const ArenaAllocator<U> &) const { return true; }
+    template <typename U> bool operator!=(const ArenaAllocator<U> &) const { return false; }
+};
+
+/// Vetor alocado na graphArena().
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
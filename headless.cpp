@@ -0,0 +1,229 @@
+/**
+ * @file headless.cpp
+ * Renderização fora da tela, sem janela.
+ */
+
+#include "headless.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLContext egl_context = EGL_NO_CONTEXT;
+static EGLSurface egl_surface = EGL_NO_SURFACE;
+
+/// Obtém o display EGL, preferindo a plataforma "surfaceless" do Mesa, que não precisa de
+/// servidor gráfico nem de dispositivo de GPU.
+static EGLDisplay getDisplay() {
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            EGLDisplay display =
+                getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool initHeadlessContext() {
+    egl_display = getDisplay();
+    if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, NULL, NULL)) {
+        std::cerr << "ERROR: Could not initialize EGL display" << std::endl;
+        return false;
+    }
+
+    EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE,
+    };
+    // Sem nenhuma configuração com pbuffer, o contexto ainda pode ser criado sem configuração
+    // (EGL_KHR_no_config_context) e usado sem superfície.
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &num_configs))
+        num_configs = 0;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "ERROR: EGL does not support desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        3,
+        EGL_CONTEXT_MINOR_VERSION,
+        3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+    if (egl_context == EGL_NO_CONTEXT) {
+        std::cerr << "ERROR: Could not create an OpenGL 3.3 context" << std::endl;
+        return false;
+    }
+
+    // Sem superfície, se suportado; senão, um pbuffer mínimo. A renderização acontece num FBO.
+    if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+        if (num_configs == 0) {
+            std::cerr << "ERROR: EGL has no pbuffer config, and the context cannot be made "
+                         "current without a surface"
+                      << std::endl;
+            return false;
+        }
+        EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        egl_surface = eglCreatePbufferSurface(egl_display, config, pbuffer_attribs);
+        if (egl_surface == EGL_NO_SURFACE ||
+            !eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)) {
+            std::cerr << "ERROR: Could not make the EGL context current" << std::endl;
+            return false;
+        }
+    }
+
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    // Sem GLX o GLEW reclama da falta de display, mas as funções do GL já foram carregadas.
+    if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+        std::cerr << "ERROR: glewInit: " << glewGetErrorString(err) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void destroyHeadlessContext() {
+    if (egl_display == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (egl_surface != EGL_NO_SURFACE)
+        eglDestroySurface(egl_display, egl_surface);
+    if (egl_context != EGL_NO_CONTEXT)
+        eglDestroyContext(egl_display, egl_context);
+    eglTerminate(egl_display);
+    egl_display = EGL_NO_DISPLAY;
+    egl_context = EGL_NO_CONTEXT;
+    egl_surface = EGL_NO_SURFACE;
+}
+#else
+bool initHeadlessContext() {
+    std::cerr << "ERROR: Headless rendering needs EGL, which is not available on Windows"
+              << std::endl;
+    return false;
+}
+
+void destroyHeadlessContext() {}
+#endif
+
+OffscreenTarget createOffscreenTarget(int width, int height) {
+    OffscreenTarget target;
+    target.width = width;
+    target.height = height;
+
+    glGenRenderbuffers(1, &target.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &target.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &target.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR: Offscreen framebuffer is incomplete" << std::endl;
+    }
+
+    glViewport(0, 0, width, height);
+    return target;
+}
+
+void destroyOffscreenTarget(OffscreenTarget &target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &target.fbo);
+    glDeleteRenderbuffers(1, &target.color);
+    glDeleteRenderbuffers(1, &target.depth);
+}
+
+void FrameCapture::init(int width, int height, const std::string &directory) {
+    this->width = width;
+    this->height = height;
+    this->directory = directory;
+    next = 0;
+
+    for (Slot &slot : slots) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 3, NULL, GL_STREAM_READ);
+        slot.fence = 0;
+        slot.frame = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::capture(int frame) {
+    Slot &slot = slots[next];
+    next = (next + 1) % RING_SIZE;
+
+    // O slot mais antigo do anel: a sua cópia já teve RING_SIZE quadros para terminar.
+    if (slot.fence)
+        write(slot);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frame;
+}
+
+void FrameCapture::finish() {
+    // Salva na ordem em que os quadros foram capturados.
+    for (int i = 0; i < RING_SIZE; i++) {
+        Slot &slot = slots[(next + i) % RING_SIZE];
+        if (slot.fence)
+            write(slot);
+    }
+    for (Slot &slot : slots) {
+        glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+void FrameCapture::write(Slot &slot) {
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    auto pixels = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                          width * height * 3, GL_MAP_READ_BIT);
+    if (pixels) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%05d.ppm", directory.c_str(), slot.frame);
+        FILE *file = fopen(path, "wb");
+        if (file) {
+            fprintf(file, "P6\n%d %d\n255\n", width, height);
+            // O OpenGL lê de baixo para cima; o PPM começa pela linha de cima.
+            for (int y = height - 1; y >= 0; y--) {
+                fwrite(pixels + (size_t)y * width * 3, 1, width * 3, file);
+            }
+            fclose(file);
+        } else {
+            std::cerr << "ERROR: Could not write " << path << std::endl;
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file headless.h
+ * Renderização fora da tela, sem janela.
+ *
+ * Permite rodar a visualização em máquinas sem display (usando o rasterizador em software do
+ * Mesa) e capturar os quadros renderizados.
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+
+/// Cria um contexto OpenGL 3.3 core sem janela, via EGL, e o torna corrente.
+///
+/// @return false se não foi possível criar o contexto.
+bool initHeadlessContext();
+
+/// Destroi o contexto criado por initHeadlessContext().
+void destroyHeadlessContext();
+
+/// Framebuffer fora da tela, com cor e profundidade.
+struct OffscreenTarget {
+    unsigned int fbo;
+    unsigned int color;
+    unsigned int depth;
+    int width;
+    int height;
+};
+
+/// Cria um framebuffer fora da tela e o deixa ligado para desenho e leitura.
+OffscreenTarget createOffscreenTarget(int width, int height);
+
+/// Libera os objetos de um framebuffer criado por createOffscreenTarget().
+void destroyOffscreenTarget(OffscreenTarget &target);
+
+/// Leitura assíncrona dos quadros renderizados para arquivos PPM.
+///
+/// Cada quadro é copiado para um pixel buffer object e só é mapeado alguns quadros depois,
+/// quando a cópia já terminou, de forma que glReadPixels não bloqueia a renderização.
+class FrameCapture {
+  public:
+    /// Prepara a captura de quadros `width` x `height`, salvos em `directory`.
+    void init(int width, int height, const std::string &directory);
+
+    /// Enfileira a leitura do framebuffer de leitura atual como o quadro `frame`.
+    void capture(int frame);
+
+    /// Espera e salva todos os quadros pendentes, e libera os buffers.
+    void finish();
+
+  private:
+    static const int RING_SIZE = 3;
+
+    struct Slot {
+        unsigned int pbo;
+        GLsync fence;
+        int frame;
+    };
+
+    Slot slots[RING_SIZE];
+    int next = 0;
+    int width = 0;
+    int height = 0;
+    std::string directory;
+
+    /// Espera a cópia do slot terminar e salva o quadro.
+    void write(Slot &slot);
+};
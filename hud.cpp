@@ -0,0 +1,247 @@
+/**
+ * @file hud.cpp
+ * Painel de texto desenhado por cima da cena.
+ */
+
+#include "hud.h"
+#include "perf.h"
+#include "utils.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <vector>
+
+/// Os caracteres da fonte, na ordem de `font`.
+static const char *font_chars = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:%/()-_=+,";
+
+/// Fonte bitmap 5x7: uma linha por byte, o bit 4 é a coluna da esquerda.
+static const unsigned char font[][7] = {
+    {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}, // 0
+    {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}, // 1
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}, // 2
+    {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}, // 3
+    {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}, // 4
+    {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}, // 5
+    {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}, // 6
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}, // 8
+    {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}, // 9
+    {0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // A
+    {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}, // B
+    {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}, // C
+    {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}, // D
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}, // E
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10}, // F
+    {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f}, // G
+    {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // H
+    {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f}, // L
+    {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // O
+    {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}, // P
+    {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d}, // Q
+    {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}, // R
+    {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}, // S
+    {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a}, // W
+    {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04}, // Y
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}, // Z
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}, // .
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}, // :
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+    {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f}, // _
+    {0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00}, // =
+    {0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00}, // +
+    {0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08}, // ,
+};
+
+/// Tamanho de uma célula da fonte na textura, com o espaçamento.
+static const int CELL_W = 6;
+static const int CELL_H = 8;
+/// Quantos pixels da tela cada pixel da fonte ocupa.
+static const int SCALE = 2;
+/// Margem do painel, em pixels.
+static const int MARGIN = 8;
+
+/** Vertex shader do HUD. */
+static const char *hud_vertex_code = "\n"
+                                     "#version 330 core\n"
+                                     "layout (location = 0) in vec2 position;\n"
+                                     "layout (location = 1) in vec2 uv;\n"
+                                     "layout (location = 2) in vec4 color;\n"
+                                     "\n"
+                                     "uniform vec2 screenSize;\n"
+                                     "\n"
+                                     "out vec2 vUv;\n"
+                                     "out vec4 vColor;\n"
+                                     "\n"
+                                     "void main()\n"
+                                     "{\n"
+                                     "    vec2 ndc = position / screenSize * 2.0 - 1.0;\n"
+                                     "    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);\n"
+                                     "    vUv = uv;\n"
+                                     "    vColor = color;\n"
+                                     "}\0";
+
+/** Fragment shader do HUD. */
+static const char *hud_fragment_code = "\n"
+                                       "#version 330 core\n"
+                                       "\n"
+                                       "in vec2 vUv;\n"
+                                       "in vec4 vColor;\n"
+                                       "\n"
+                                       "out vec4 fragColor;\n"
+                                       "\n"
+                                       "uniform sampler2D font;\n"
+                                       "\n"
+                                       "void main()\n"
+                                       "{\n"
+                                       "    float alpha = vColor.a * texture(font, vUv).r;\n"
+                                       "    fragColor = vec4(vColor.rgb, alpha);\n"
+                                       "}\0";
+
+static int hud_program;
+static unsigned int VAO_HUD;
+static unsigned int VBO_HUD;
+static unsigned int font_texture;
+/// Número de células na textura: os caracteres da fonte e uma célula cheia, usada no fundo.
+static int font_cells;
+
+/// Vértices do quadro atual: posição, uv e cor (8 floats por vértice).
+static std::vector<float> hud_vertices;
+
+void initHud() {
+    hud_program = createShaderProgram(hud_vertex_code, hud_fragment_code);
+
+    int count = strlen(font_chars);
+    font_cells = count + 1;
+
+    // Monta a textura com os caracteres lado a lado.
+    int tex_w = font_cells * CELL_W;
+    std::vector<unsigned char> pixels(tex_w * CELL_H, 0);
+    for (int c = 0; c < count; c++) {
+        for (int y = 0; y < 7; y++) {
+            for (int x = 0; x < 5; x++) {
+                if (font[c][y] & (0x10 >> x))
+                    pixels[y * tex_w + c * CELL_W + x] = 255;
+            }
+        }
+    }
+    for (int y = 0; y < CELL_H; y++) {
+        for (int x = 0; x < CELL_W; x++) {
+            pixels[y * tex_w + count * CELL_W + x] = 255;
+        }
+    }
+
+    glGenTextures(1, &font_texture);
+    glBindTexture(GL_TEXTURE_2D, font_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, tex_w, CELL_H, 0, GL_RED, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &VAO_HUD);
+    glBindVertexArray(VAO_HUD);
+
+    glGenBuffers(1, &VBO_HUD);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_HUD);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(4 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+}
+
+/// Adiciona um retângulo com a célula `cell` da fonte.
+static void pushQuad(float x, float y, float w, float h, int cell, const float color[4]) {
+    float u0 = (float)cell / font_cells;
+    float u1 = (float)(cell + 1) / font_cells;
+    float corners[6][4] = {
+        {x, y, u0, 0.0f},     {x + w, y, u1, 0.0f},     {x + w, y + h, u1, 1.0f},
+        {x, y, u0, 0.0f},     {x + w, y + h, u1, 1.0f}, {x, y + h, u0, 1.0f},
+    };
+    for (auto &corner : corners) {
+        hud_vertices.insert(hud_vertices.end(), corner, corner + 4);
+        hud_vertices.insert(hud_vertices.end(), color, color + 4);
+    }
+}
+
+void drawHud(const char *text, int width, int height) {
+    static const float background[4] = {0.0f, 0.0f, 0.0f, 0.6f};
+    static const float foreground[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    const int char_w = CELL_W * SCALE;
+    const int char_h = CELL_H * SCALE;
+
+    // Tamanho do painel.
+    int columns = 0, lines = 1, column = 0;
+    for (const char *c = text; *c; c++) {
+        if (*c == '\n') {
+            lines++;
+            column = 0;
+        } else {
+            column++;
+            if (column > columns)
+                columns = column;
+        }
+    }
+
+    hud_vertices.clear();
+    int solid = font_cells - 1;
+    pushQuad(0, 0, columns * char_w + 2 * MARGIN, lines * char_h + 2 * MARGIN, solid, background);
+
+    float x = MARGIN, y = MARGIN;
+    for (const char *c = text; *c; c++) {
+        if (*c == '\n') {
+            x = MARGIN;
+            y += char_h;
+            continue;
+        }
+        const char *found = strchr(font_chars, toupper((unsigned char)*c));
+        if (*c != ' ' && found) {
+            pushQuad(x, y, char_w, char_h, found - font_chars, foreground);
+        }
+        x += char_w;
+    }
+
+    GL_COUNTED(glDisable(GL_DEPTH_TEST));
+    GL_COUNTED(glEnable(GL_BLEND));
+    GL_COUNTED(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    GL_COUNTED(glUseProgram(hud_program));
+    GLint loc = GL_COUNTED(glGetUniformLocation(hud_program, "screenSize"));
+    GL_COUNTED(glUniform2f(loc, width, height));
+    loc = GL_COUNTED(glGetUniformLocation(hud_program, "font"));
+    GL_COUNTED(glUniform1i(loc, 0));
+    GL_COUNTED(glActiveTexture(GL_TEXTURE0));
+    GL_COUNTED(glBindTexture(GL_TEXTURE_2D, font_texture));
+
+    GL_COUNTED(glBindVertexArray(VAO_HUD));
+    GL_COUNTED(glBindBuffer(GL_ARRAY_BUFFER, VBO_HUD));
+    GL_COUNTED(glBufferData(GL_ARRAY_BUFFER, sizeof(float) * hud_vertices.size(),
+                            hud_vertices.data(), GL_STREAM_DRAW));
+    countUpload(sizeof(float) * hud_vertices.size());
+    GL_COUNTED(glDrawArrays(GL_TRIANGLES, 0, hud_vertices.size() / 8));
+    countDrawCall();
+
+    GL_COUNTED(glBindVertexArray(0));
+    GL_COUNTED(glDisable(GL_BLEND));
+    GL_COUNTED(glEnable(GL_DEPTH_TEST));
+}
@@ -0,0 +1,15 @@
+/**
+ * @file hud.h
+ * Painel de texto desenhado por cima da cena.
+ */
+
+#pragma once
+
+/// Cria o programa, a textura da fonte e os buffers do HUD.
+void initHud();
+
+/// Desenha `text` no canto superior esquerdo de uma tela `width` x `height`.
+///
+/// O texto pode ter várias linhas, separadas por '\n'. Letras minúsculas são desenhadas como
+/// maiúsculas, e caracteres fora da fonte como espaços.
+void drawHud(const char *text, int width, int height);
@@ -0,0 +1,99 @@
+/**
+ * @file hw_counters.cpp
+ * Contadores de desempenho do processador, lidos com perf_event_open no Linux.
+ */
+
+#include "hw_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *hw_counter_names[HW_COUNTER_COUNT] = {"cycles", "instructions", "l1d_misses",
+                                                  "llc_misses", "branch_misses"};
+
+double HwSample::ipc() const {
+    if (!valid[HW_CYCLES] || !valid[HW_INSTRUCTIONS] || value[HW_CYCLES] == 0)
+        return -1.0;
+    return (double)value[HW_INSTRUCTIONS] / value[HW_CYCLES];
+}
+
+#ifdef __linux__
+
+/// Abre um contador do thread atual, desligado.
+static int openCounter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool HwCounters::init() {
+    const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    fds[HW_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds[HW_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[HW_L1D_MISSES] = openCounter(PERF_TYPE_HW_CACHE, l1d_read_miss);
+    fds[HW_LLC_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds[HW_BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+    bool any = false;
+    for (int fd : fds)
+        any |= fd >= 0;
+    return any;
+}
+
+void HwCounters::destroy() {
+    for (int &fd : fds) {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+}
+
+void HwCounters::start() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+HwSample HwCounters::stop() {
+    for (int fd : fds) {
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    HwSample sample = {};
+    for (int c = 0; c < HW_COUNTER_COUNT; c++) {
+        // Valor, tempo ligado e tempo em que o contador realmente contou.
+        uint64_t data[3];
+        if (fds[c] < 0 || read(fds[c], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+            continue;
+        sample.valid[c] = true;
+        sample.value[c] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2])
+                                            : data[0];
+    }
+    return sample;
+}
+
+#else
+
+bool HwCounters::init() { return false; }
+void HwCounters::destroy() {}
+void HwCounters::start() {}
+HwSample HwCounters::stop() { return HwSample{}; }
+
+#endif
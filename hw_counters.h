@@ -0,0 +1,58 @@
+/**
+ * @file hw_counters.h
+ * Contadores de desempenho do processador (ciclos, instruções, falhas de cache e de previsão de
+ * desvios), lidos com perf_event_open no Linux.
+ *
+ * Os contadores medem só o thread que chamou init(). Cada contador é aberto separadamente, e os
+ * que o processador ou o kernel não oferecem (por exemplo numa máquina virtual, ou com
+ * `/proc/sys/kernel/perf_event_paranoid` alto) ficam indisponíveis, sem afetar os outros. Fora do
+ * Linux nenhum contador está disponível.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/// Os contadores medidos.
+enum HwCounter {
+    HW_CYCLES,
+    HW_INSTRUCTIONS,
+    /// Leituras que falharam no cache L1 de dados.
+    HW_L1D_MISSES,
+    /// Acessos que falharam no último nível de cache.
+    HW_LLC_MISSES,
+    HW_BRANCH_MISSES,
+    HW_COUNTER_COUNT
+};
+
+/// Nomes dos contadores, na ordem de HwCounter.
+extern const char *hw_counter_names[HW_COUNTER_COUNT];
+
+/// Valores dos contadores num intervalo.
+struct HwSample {
+    /// Se o contador estava disponível.
+    bool valid[HW_COUNTER_COUNT];
+    /// Valor do contador, corrigido pela fração do tempo em que ele esteve ativo, quando o kernel
+    /// precisa revezar os contadores.
+    uint64_t value[HW_COUNTER_COUNT];
+
+    /// Instruções por ciclo, ou -1 se algum dos dois contadores não estava disponível.
+    double ipc() const;
+};
+
+class HwCounters {
+  public:
+    /// Abre os contadores para o thread atual.
+    ///
+    /// @return false se nenhum contador está disponível.
+    bool init();
+    void destroy();
+
+    /// Zera e liga os contadores.
+    void start();
+    /// Desliga os contadores e lê os valores desde start().
+    HwSample stop();
+
+  private:
+    int fds[HW_COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+};
@@ -0,0 +1,109 @@
+/**
+ * @file mapped_file.cpp
+ * Arquivo mapeado em memória, somente leitura.
+ */
+
+#include "mapped_file.h"
+
+#include <stdio.h>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        bytes = other.bytes;
+        length = other.length;
+        owned = other.owned;
+        other.bytes = nullptr;
+        other.length = 0;
+        other.owned = false;
+    }
+    return *this;
+}
+
+#ifndef _WIN32
+bool MappedFile::open(const char *path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    length = st.st_size;
+    if (length == 0) {
+        // mmap não aceita tamanho zero; um arquivo vazio é um buffer vazio.
+        ::close(fd);
+        bytes = "";
+        return true;
+    }
+
+    void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    // O arquivo é lido do começo ao fim.
+    madvise(map, length, MADV_SEQUENTIAL);
+
+    bytes = (const char *)map;
+    owned = false;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes && owned)
+        delete[] bytes;
+    else if (bytes && length > 0)
+        munmap((void *)bytes, length);
+    bytes = nullptr;
+    length = 0;
+    owned = false;
+}
+#else
+bool MappedFile::open(const char *path) {
+    close();
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *buffer = new char[length + 1];
+    length = fread(buffer, 1, length, file);
+    buffer[length] = '\0';
+    fclose(file);
+
+    bytes = buffer;
+    owned = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes && owned)
+        delete[] bytes;
+    bytes = nullptr;
+    length = 0;
+    owned = false;
+}
+#endif
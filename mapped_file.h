@@ -0,0 +1,39 @@
+/**
+ * @file mapped_file.h
+ * Arquivo mapeado em memória, somente leitura.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/// Um arquivo inteiro mapeado em memória.
+///
+/// Usa mmap onde existe; no Windows o arquivo é lido para um buffer.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    /// Mapeia o arquivo `path`, desfazendo um mapeamento anterior.
+    ///
+    /// @return false se o arquivo não pôde ser aberto.
+    bool open(const char *path);
+
+    /// Desfaz o mapeamento.
+    void close();
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+  private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+    /// Se `bytes` foi alocado com new[] em vez de mapeado.
+    bool owned = false;
+};
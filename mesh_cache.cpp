@@ -0,0 +1,158 @@
+/**
+ * @file mesh_cache.cpp
+ * Cache binário dos modelos já processados.
+ */
+
+#include "mesh_cache.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/// Muda sempre que o formato do cache, ou o processamento dos vértices, mudar.
+static const uint32_t MESH_CACHE_VERSION = 7;
+static const char MESH_CACHE_MAGIC[4] = {'P', 'M', 'S', 'H'};
+
+/// Cabeçalho do arquivo de cache, seguido pela tabela de níveis de detalhe (MeshLod), pelos
+/// vértices e pelos índices.
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    /// Tamanho, data de modificação e hash do OBJ de onde o cache foi gerado.
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    /// Número de vértices, com 6 floats cada.
+    uint64_t vertex_count;
+    /// Número de índices e o tamanho de cada um, em bytes.
+    uint64_t index_count;
+    uint64_t index_size;
+    /// Número de níveis de detalhe.
+    uint64_t lod_count;
+};
+
+/// Hash de 64 bits do conteúdo de um arquivo, lido 8 bytes por vez.
+static uint64_t hashBytes(const char *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/// Tamanho e data de modificação do OBJ.
+static bool statSource(const char *source, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(source, &st) != 0)
+        return false;
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+/// Hash do conteúdo atual do OBJ.
+static bool hashSource(const char *source, uint64_t &hash) {
+    MappedFile file;
+    if (!file.open(source))
+        return false;
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+std::string meshCachePath(const char *source) { return std::string(source) + ".cache"; }
+
+bool openMeshCache(const char *source, Mesh &mesh) {
+    uint64_t size;
+    int64_t mtime;
+    if (!statSource(source, size, mtime))
+        return false;
+
+    std::string path = meshCachePath(source);
+    MappedFile file;
+    if (!file.open(path.c_str()) || file.size() < sizeof(MeshCacheHeader))
+        return false;
+
+    MeshCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    size_t lod_bytes = header.lod_count * sizeof(MeshLod);
+    size_t vertex_bytes = header.vertex_count * 6 * sizeof(float);
+    if (memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 || header.version != MESH_CACHE_VERSION ||
+        (header.index_size != 2 && header.index_size != 4) || header.lod_count == 0 ||
+        header.lod_count > MAX_MESH_LODS ||
+        file.size() !=
+            sizeof(header) + lod_bytes + vertex_bytes + header.index_count * header.index_size)
+        return false;
+
+    std::vector<MeshLod> lods(header.lod_count);
+    memcpy(lods.data(), file.data() + sizeof(header), lod_bytes);
+    for (const MeshLod &lod : lods) {
+        if ((uint64_t)lod.index_offset + lod.index_count > header.index_count)
+            return false;
+    }
+
+    if (header.source_size != size || header.source_mtime != mtime) {
+        // O OBJ pode só ter sido copiado ou tocado; o hash decide se o conteúdo mudou.
+        uint64_t hash;
+        if (header.source_size != size || !hashSource(source, hash) ||
+            hash != header.source_hash)
+            return false;
+
+        // Atualiza a data no cache, para não recalcular o hash na próxima vez.
+        FILE *out = fopen(path.c_str(), "r+b");
+        if (out) {
+            header.source_mtime = mtime;
+            fwrite(&header, sizeof(header), 1, out);
+            fclose(out);
+        }
+    }
+
+    size_t vertex_offset = sizeof(header) + lod_bytes;
+    mesh.setMapped(std::move(file), vertex_offset, header.vertex_count,
+                   vertex_offset + vertex_bytes, header.index_count, header.index_size);
+    mesh.setLods(std::move(lods));
+    return true;
+}
+
+bool writeMeshCache(const char *source, const Mesh &mesh) {
+    MeshCacheHeader header;
+    memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version = MESH_CACHE_VERSION;
+    header.vertex_count = mesh.vertexCount();
+    header.index_count = mesh.indexCount();
+    header.index_size = mesh.indexSize();
+    header.lod_count = mesh.lods().size();
+    if (!statSource(source, header.source_size, header.source_mtime) ||
+        !hashSource(source, header.source_hash))
+        return false;
+
+    // Escreve num arquivo temporário e renomeia, para nunca deixar um cache pela metade.
+    std::string path = meshCachePath(source);
+    std::string temp = path + ".tmp";
+    FILE *out = fopen(temp.c_str(), "wb");
+    if (!out)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(mesh.lods().data(), sizeof(MeshLod), header.lod_count, out) ==
+                  header.lod_count &&
+              fwrite(mesh.vertices(), 1, mesh.vertexBytes(), out) == mesh.vertexBytes() &&
+              fwrite(mesh.indices(), 1, mesh.indexBytes(), out) == mesh.indexBytes();
+    ok = fclose(out) == 0 && ok;
+
+    if (ok) {
+        remove(path.c_str());
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok)
+        remove(temp.c_str());
+    return ok;
+}
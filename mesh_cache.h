@@ -0,0 +1,28 @@
+/**
+ * @file mesh_cache.h
+ * Cache binário dos modelos já processados.
+ *
+ * Ao lado de cada OBJ é guardado um arquivo `.cache` com os vértices e índices prontos para a
+ * GPU. Nas próximas execuções ele é mapeado em memória e enviado direto para o glBufferData, sem
+ * ler o OBJ. O cache guarda o tamanho, a data de modificação e um hash do OBJ, e é refeito
+ * quando o OBJ muda.
+ */
+
+#pragma once
+
+#include "model.h"
+
+#include <string>
+
+/// Caminho do cache do OBJ `source`.
+std::string meshCachePath(const char *source);
+
+/// Abre o cache de `source`, se existir e estiver atualizado.
+///
+/// @return false se não há cache válido para o OBJ atual.
+bool openMeshCache(const char *source, Mesh &mesh);
+
+/// Escreve o cache de `source` com os dados de `mesh`.
+///
+/// @return false se o arquivo não pôde ser escrito.
+bool writeMeshCache(const char *source, const Mesh &mesh);
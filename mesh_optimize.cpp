@@ -0,0 +1,185 @@
+/**
+ * @file mesh_optimize.cpp
+ * Reordenação de malhas indexadas para a GPU.
+ */
+
+#include "mesh_optimize.h"
+
+#include <math.h>
+
+/// Tamanho do cache LRU simulado durante a reordenação dos triângulos.
+static const int FORSYTH_CACHE_SIZE = 32;
+
+/// Pontuação de um vértice: maior para os que estão no começo do cache e para os que restam em
+/// poucos triângulos, que devem ser terminados logo.
+static float vertexScore(int cache_pos, int live) {
+    if (live == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_pos >= 0) {
+        if (cache_pos < 3) {
+            // Os vértices do último triângulo ganham uma pontuação fixa, para não favorecer a
+            // ordem em que ele foi emitido.
+            score = 0.75f;
+        } else {
+            float scaled = 1.0f - float(cache_pos - 3) / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(scaled, 1.5f);
+        }
+    }
+    score += 2.0f / sqrtf(float(live));
+    return score;
+}
+
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertex_count, int cache_size) {
+    if (indices.size() < 3)
+        return 0.0f;
+
+    // Instante em que cada vértice entrou no cache; sai depois de `cache_size` entradas.
+    std::vector<size_t> entered(vertex_count, 0);
+    size_t time = cache_size + 1;
+    size_t misses = 0;
+    for (uint32_t v : indices) {
+        if (time - entered[v] > (size_t)cache_size) {
+            entered[v] = time++;
+            misses++;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count) {
+    size_t tri_count = indices.size() / 3;
+    if (tri_count == 0)
+        return;
+
+    // Triângulos de cada vértice, em listas contíguas. Os primeiros `live[v]` da lista de `v`
+    // ainda não foram emitidos.
+    std::vector<int> live(vertex_count, 0);
+    for (uint32_t v : indices)
+        live[v]++;
+    std::vector<size_t> adjacency_start(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++)
+        adjacency_start[v + 1] = adjacency_start[v] + live[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<size_t> fill(adjacency_start.begin(), adjacency_start.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cache_pos(vertex_count, -1);
+    std::vector<float> score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        score[v] = vertexScore(-1, live[v]);
+
+    auto triScore = [&](size_t t) {
+        return score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+    };
+
+    std::vector<bool> emitted(tri_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    long best = 0;
+    float best_score = -1.0f;
+    for (size_t t = 0; t < tri_count; t++) {
+        float s = triScore(t);
+        if (s > best_score) {
+            best_score = s;
+            best = t;
+        }
+    }
+
+    std::vector<uint32_t> cache, next_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t next_unemitted = 0;
+
+    for (size_t n = 0; n < tri_count; n++) {
+        if (best < 0) {
+            // Nenhum triângulo ligado ao cache: continua pelo primeiro que falta.
+            while (emitted[next_unemitted])
+                next_unemitted++;
+            best = next_unemitted;
+        }
+
+        const uint32_t *tri = &indices[3 * best];
+        output.insert(output.end(), tri, tri + 3);
+        emitted[best] = true;
+
+        // Tira o triângulo das listas dos seus vértices.
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = tri[k];
+            uint32_t *list = &adjacency[adjacency_start[v]];
+            for (int i = 0; i < live[v]; i++) {
+                if (list[i] == (uint32_t)best) {
+                    list[i] = list[live[v] - 1];
+                    live[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Os vértices do triângulo vão para o começo do cache.
+        next_cache.clear();
+        for (int k = 0; k < 3; k++) {
+            if (k > 0 && tri[k] == tri[0])
+                continue;
+            if (k > 1 && tri[k] == tri[1])
+                continue;
+            next_cache.push_back(tri[k]);
+        }
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                next_cache.push_back(v);
+        }
+        for (size_t i = FORSYTH_CACHE_SIZE; i < next_cache.size(); i++) {
+            uint32_t v = next_cache[i];
+            cache_pos[v] = -1;
+            score[v] = vertexScore(-1, live[v]);
+        }
+        if (next_cache.size() > FORSYTH_CACHE_SIZE)
+            next_cache.resize(FORSYTH_CACHE_SIZE);
+        cache.swap(next_cache);
+
+        for (size_t i = 0; i < cache.size(); i++) {
+            uint32_t v = cache[i];
+            cache_pos[v] = i;
+            score[v] = vertexScore(i, live[v]);
+        }
+
+        // O próximo triângulo é o de maior pontuação entre os que usam vértices do cache.
+        best = -1;
+        best_score = -1.0f;
+        for (uint32_t v : cache) {
+            const uint32_t *list = &adjacency[adjacency_start[v]];
+            for (int i = 0; i < live[v]; i++) {
+                float s = triScore(list[i]);
+                if (s > best_score) {
+                    best_score = s;
+                    best = list[i];
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<float> &vertices, std::vector<uint32_t> &indices,
+                         size_t stride) {
+    size_t vertex_count = vertices.size() / stride;
+    std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+    std::vector<float> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t &v : indices) {
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = reordered.size() / stride;
+            const float *src = &vertices[v * stride];
+            reordered.insert(reordered.end(), src, src + stride);
+        }
+        v = remap[v];
+    }
+
+    vertices.swap(reordered);
+}
@@ -0,0 +1,30 @@
+/**
+ * @file mesh_optimize.h
+ * Reordenação de malhas indexadas para a GPU.
+ *
+ * Os triângulos são reordenados para aproveitar o cache de vértices transformados (algoritmo de
+ * Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"), e depois os vértices são renumerados
+ * na ordem em que são usados, para que a leitura do vertex buffer seja sequencial.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// Tamanho do cache FIFO usado para medir o ACMR.
+const int ACMR_CACHE_SIZE = 16;
+
+/// Média de vértices transformados por triângulo (ACMR), simulando um cache FIFO de
+/// `cache_size` vértices. Vai de 0.5, no melhor caso, até 3.
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertex_count,
+                  int cache_size = ACMR_CACHE_SIZE);
+
+/// Reordena os triângulos de `indices` para melhorar o reuso do cache de vértices.
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count);
+
+/// Renumera os vértices na ordem em que aparecem em `indices` e reordena `vertices`, com
+/// `stride` floats por vértice, de acordo. Vértices não usados são removidos.
+void optimizeVertexFetch(std::vector<float> &vertices, std::vector<uint32_t> &indices,
+                         size_t stride);
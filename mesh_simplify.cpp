@@ -0,0 +1,279 @@
+/**
+ * @file mesh_simplify.cpp
+ * Simplificação de malhas indexadas por métrica de erro quádrico.
+ */
+
+#include "mesh_simplify.h"
+
+#include <algorithm>
+#include <math.h>
+
+/// Peso dos planos que prendem as bordas abertas da malha, relativo ao das faces.
+static const double BOUNDARY_WEIGHT = 10.0;
+
+namespace {
+
+struct Vec3 {
+    double x, y, z;
+
+    Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+    double dot(const Vec3 &o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec3 cross(const Vec3 &o) const {
+        return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x};
+    }
+    double length() const { return sqrt(dot(*this)); }
+};
+
+/// Forma quádrica simétrica que dá a soma dos quadrados das distâncias de um ponto a um conjunto
+/// de planos.
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    /// Soma o plano de normal unitária `n` que passa por `p`, com peso `w`.
+    void addPlane(const Vec3 &n, const Vec3 &p, double w) {
+        double d = -n.dot(p);
+        a2 += w * n.x * n.x;
+        ab += w * n.x * n.y;
+        ac += w * n.x * n.z;
+        ad += w * n.x * d;
+        b2 += w * n.y * n.y;
+        bc += w * n.y * n.z;
+        bd += w * n.y * d;
+        c2 += w * n.z * n.z;
+        cd += w * n.z * d;
+        d2 += w * d * d;
+    }
+
+    void add(const Quadric &q) {
+        a2 += q.a2;
+        ab += q.ab;
+        ac += q.ac;
+        ad += q.ad;
+        b2 += q.b2;
+        bc += q.bc;
+        bd += q.bd;
+        c2 += q.c2;
+        cd += q.cd;
+        d2 += q.d2;
+    }
+
+    double evaluate(const Vec3 &p) const {
+        double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+                   b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y + c2 * p.z * p.z +
+                   2 * cd * p.z + d2;
+        return e > 0 ? e : 0;
+    }
+};
+
+/// Chave de uma aresta, independente da ordem dos seus dois vértices.
+inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return (uint64_t)std::min(a, b) << 32 | std::max(a, b);
+}
+
+/// Um colapso candidato: a posição `from` passa a ser a posição `to`.
+struct Collapse {
+    uint32_t from, to;
+    double cost;
+};
+
+} // namespace
+
+std::vector<uint32_t> simplifyMesh(const std::vector<float> &vertices, size_t stride,
+                                   const std::vector<uint32_t> &indices, size_t target_index_count,
+                                   float &error) {
+    error = 0.0f;
+    size_t vertex_count = vertices.size() / stride;
+
+    // Junta os vértices com a mesma posição, para que as costuras de normais não se abram:
+    // ordenados pela posição, os vértices iguais ficam vizinhos.
+    std::vector<uint32_t> position_of(vertex_count);
+    std::vector<Vec3> positions;
+    {
+        std::vector<uint32_t> order(vertex_count);
+        for (size_t v = 0; v < vertex_count; v++)
+            order[v] = v;
+        auto less = [&](uint32_t a, uint32_t b) {
+            const float *p = &vertices[a * stride], *q = &vertices[b * stride];
+            return std::lexicographical_compare(p, p + 3, q, q + 3);
+        };
+        std::sort(order.begin(), order.end(), less);
+        for (size_t i = 0; i < vertex_count; i++) {
+            if (i == 0 || less(order[i - 1], order[i])) {
+                const float *p = &vertices[order[i] * stride];
+                positions.push_back({p[0], p[1], p[2]});
+            }
+            position_of[order[i]] = positions.size() - 1;
+        }
+    }
+    size_t position_count = positions.size();
+
+    std::vector<uint32_t> triangles(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        triangles[i] = position_of[indices[i]];
+
+    // Quádricas dos planos das faces em volta de cada posição, e das bordas abertas. As arestas
+    // de todas as faces ficam ordenadas, e uma aresta que aparece uma vez só é uma borda.
+    std::vector<Quadric> quadrics(position_count);
+    std::vector<uint64_t> edges;
+    edges.reserve(triangles.size());
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        const Vec3 &p0 = positions[triangles[t]];
+        Vec3 n = (positions[triangles[t + 1]] - p0).cross(positions[triangles[t + 2]] - p0);
+        double length = n.length();
+        if (length == 0)
+            continue;
+        n = {n.x / length, n.y / length, n.z / length};
+        for (int k = 0; k < 3; k++) {
+            quadrics[triangles[t + k]].addPlane(n, p0, 1.0);
+            edges.push_back(edgeKey(triangles[t + k], triangles[t + (k + 1) % 3]));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    auto edgeUse = [&](uint64_t key) {
+        auto range = std::equal_range(edges.begin(), edges.end(), key);
+        return range.second - range.first;
+    };
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        const Vec3 &p0 = positions[triangles[t]];
+        Vec3 n = (positions[triangles[t + 1]] - p0).cross(positions[triangles[t + 2]] - p0);
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = triangles[t + k], b = triangles[t + (k + 1) % 3];
+            if (edgeUse(edgeKey(a, b)) != 1)
+                continue;
+            // Plano perpendicular à face, contendo a aresta da borda.
+            Vec3 side = (positions[b] - positions[a]).cross(n);
+            double length = side.length();
+            if (length == 0)
+                continue;
+            side = {side.x / length, side.y / length, side.z / length};
+            quadrics[a].addPlane(side, positions[a], BOUNDARY_WEIGHT);
+            quadrics[b].addPlane(side, positions[a], BOUNDARY_WEIGHT);
+        }
+    }
+
+    // Cada passada colapsa as arestas mais baratas, no máximo uma em cada vizinhança, e depois
+    // refaz a lista de triângulos.
+    std::vector<uint32_t> remap(position_count);
+    for (size_t p = 0; p < position_count; p++)
+        remap[p] = p;
+    std::vector<bool> locked(position_count);
+    std::vector<std::vector<uint32_t>> around(position_count);
+    std::vector<Collapse> collapses;
+    double max_cost = 0.0;
+
+    while (triangles.size() > target_index_count) {
+        for (auto &list : around)
+            list.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int k = 0; k < 3; k++)
+                around[triangles[t + k]].push_back(t);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = triangles[t + k], b = triangles[t + (k + 1) % 3];
+                Quadric q = quadrics[a];
+                q.add(quadrics[b]);
+                double to_b = q.evaluate(positions[b]);
+                double to_a = q.evaluate(positions[a]);
+                if (to_b <= to_a)
+                    collapses.push_back({a, b, to_b});
+                else
+                    collapses.push_back({b, a, to_a});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        std::fill(locked.begin(), locked.end(), false);
+        size_t remaining = triangles.size();
+        size_t collapsed = 0;
+        for (const Collapse &c : collapses) {
+            if (remaining <= target_index_count)
+                break;
+            if (locked[c.from] || locked[c.to])
+                continue;
+
+            // Rejeita o colapso se algum triângulo em volta de `from` virar do avesso.
+            bool flips = false;
+            size_t removed = 0;
+            for (uint32_t t : around[c.from]) {
+                const uint32_t *tri = &triangles[t];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                    removed += 3;
+                    continue;
+                }
+                Vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++) {
+                    p[k] = positions[tri[k]];
+                    q[k] = tri[k] == c.from ? positions[c.to] : p[k];
+                }
+                Vec3 before = (p[1] - p[0]).cross(p[2] - p[0]);
+                Vec3 after = (q[1] - q[0]).cross(q[2] - q[0]);
+                if (before.dot(after) <= 0) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips)
+                continue;
+
+            // A vizinhança de `from` muda; ela fica para a próxima passada.
+            for (uint32_t t : around[c.from]) {
+                for (int k = 0; k < 3; k++)
+                    locked[triangles[t + k]] = true;
+            }
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            max_cost = std::max(max_cost, c.cost);
+            remaining -= removed;
+            collapsed++;
+        }
+        if (collapsed == 0)
+            break;
+
+        // Aplica os colapsos e descarta os triângulos que ficaram sem área.
+        size_t out = 0;
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            uint32_t a = remap[triangles[t]], b = remap[triangles[t + 1]],
+                     c = remap[triangles[t + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            triangles[out++] = a;
+            triangles[out++] = b;
+            triangles[out++] = c;
+        }
+        triangles.resize(out);
+        for (size_t p = 0; p < position_count; p++)
+            remap[p] = p;
+    }
+    error = sqrt(max_cost);
+
+    // Volta das posições para os vértices: cada canto pega, entre os vértices na sua posição, o de
+    // normal mais parecida com a do triângulo.
+    std::vector<std::vector<uint32_t>> vertices_at(position_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        vertices_at[position_of[v]].push_back(v);
+
+    std::vector<uint32_t> result;
+    result.reserve(triangles.size());
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        const Vec3 &p0 = positions[triangles[t]];
+        Vec3 n = (positions[triangles[t + 1]] - p0).cross(positions[triangles[t + 2]] - p0);
+        for (int k = 0; k < 3; k++) {
+            uint32_t best = vertices_at[triangles[t + k]][0];
+            double best_dot = -INFINITY;
+            for (uint32_t v : vertices_at[triangles[t + k]]) {
+                const float *normal = &vertices[v * stride + 3];
+                double d = n.dot({normal[0], normal[1], normal[2]});
+                if (d > best_dot) {
+                    best_dot = d;
+                    best = v;
+                }
+            }
+            result.push_back(best);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file mesh_simplify.h
+ * Simplificação de malhas indexadas por métrica de erro quádrico (Garland e Heckbert).
+ *
+ * As arestas são colapsadas para um dos seus dois vértices, sem criar vértices novos, então
+ * todos os níveis de detalhe de um modelo podem usar o mesmo vertex buffer e mudar só os
+ * índices.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// Simplifica os triângulos `indices` até ficar com no máximo `target_index_count` índices, ou
+/// até não haver mais aresta que possa ser colapsada sem inverter um triângulo.
+///
+/// Os vértices têm `stride` floats, com a posição nos três primeiros e a normal nos três
+/// seguintes. Vértices na mesma posição com normais diferentes são tratados como um ponto só, e
+/// cada canto dos triângulos restantes usa o vértice da sua posição com a normal mais parecida
+/// com a do triângulo.
+///
+/// @param error Recebe o erro do colapso mais caro, como uma distância no espaço do modelo.
+/// @return Os índices dos triângulos restantes, referindo-se aos mesmos vértices.
+std::vector<uint32_t> simplifyMesh(const std::vector<float> &vertices, size_t stride,
+                                   const std::vector<uint32_t> &indices, size_t target_index_count,
+                                   float &error);
@@ -0,0 +1,468 @@
+/**
+ * @file model.cpp
+ * Carregamento dos modelos desenhados na cena.
+ */
+
+#include "model.h"
+#include "alloc_stats.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include "obj_parser.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <iostream>
+#include <istream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+/// Menor número de triângulos de um nível de detalhe simplificado. Abaixo disso o modelo já é
+/// barato, e simplificá-lo mais o deforma.
+static const size_t MIN_LOD_TRIANGLES = 32;
+/// Maior erro de um nível de detalhe, como fração da diagonal da caixa do modelo.
+static const float MAX_LOD_ERROR = 0.05f;
+
+/// Lê o OBJ com o tinyobj::ObjReader.
+static bool readWithTinyObj(const char *path, tinyobj::attrib_t &attrib,
+                            std::vector<tinyobj::shape_t> &shapes) {
+    tinyobj::ObjReaderConfig reader_config;
+    reader_config.mtl_search_path = "./"; // Path to material files
+
+    tinyobj::ObjReader reader;
+
+    if (!reader.ParseFromFile(path, reader_config)) {
+        if (!reader.Error().empty()) {
+            std::cerr << "TinyObjReader: " << reader.Error();
+        }
+        return false;
+    }
+
+    if (!reader.Warning().empty()) {
+        std::cout << "TinyObjReader: " << reader.Warning();
+    }
+
+    attrib = reader.GetAttrib();
+    shapes = reader.GetShapes();
+    return true;
+}
+
+void Mesh::setData(std::vector<float> &&vertices, const std::vector<uint32_t> &indices) {
+    mapping.close();
+    vertex_storage = std::move(vertices);
+    vertex_data = vertex_storage.data();
+    vertex_count = vertex_storage.size() / 6;
+
+    // Índices de 16 bits bastam para até 65536 vértices.
+    index_size = vertex_count <= 65536 ? 2 : 4;
+    index_count = indices.size();
+    index_storage.resize(index_count * index_size);
+    if (index_size == 2) {
+        uint16_t *out = (uint16_t *)index_storage.data();
+        for (size_t i = 0; i < index_count; i++)
+            out[i] = indices[i];
+    } else {
+        memcpy(index_storage.data(), indices.data(), index_count * 4);
+    }
+    index_data = index_storage.data();
+    lod_table = {MeshLod{0, (uint32_t)index_count, 0.0f}};
+}
+
+void Mesh::setMapped(MappedFile &&file, size_t vertex_offset, size_t vertices,
+                     size_t index_offset, size_t indices, size_t index_bytes) {
+    vertex_storage = std::vector<float>();
+    index_storage = std::vector<unsigned char>();
+    mapping = std::move(file);
+    vertex_data = (const float *)(mapping.data() + vertex_offset);
+    vertex_count = vertices;
+    index_data = mapping.data() + index_offset;
+    index_count = indices;
+    index_size = index_bytes;
+    lod_table = {MeshLod{0, (uint32_t)index_count, 0.0f}};
+}
+
+void Mesh::setStatic(const float *vertices, size_t vertices_count, const void *indices,
+                     size_t indices_count, size_t index_bytes) {
+    vertex_storage = std::vector<float>();
+    index_storage = std::vector<unsigned char>();
+    mapping.close();
+    vertex_data = vertices;
+    vertex_count = vertices_count;
+    index_data = indices;
+    index_count = indices_count;
+    index_size = index_bytes;
+    lod_table = {MeshLod{0, (uint32_t)index_count, 0.0f}};
+}
+
+std::vector<unsigned char> packCompactVertices(const Mesh &mesh) {
+    std::vector<unsigned char> packed(mesh.vertexCount() * COMPACT_VERTEX_SIZE);
+    for (size_t i = 0; i < mesh.vertexCount(); i++) {
+        const float *v = mesh.vertices() + 6 * i;
+        uint16_t position[4] = {glm::packHalf1x16(v[0]), glm::packHalf1x16(v[1]),
+                                glm::packHalf1x16(v[2]), 0};
+        uint32_t normal = glm::packSnorm3x10_1x2(glm::vec4(v[3], v[4], v[5], 0.0f));
+
+        unsigned char *out = &packed[i * COMPACT_VERTEX_SIZE];
+        memcpy(out, position, 8);
+        memcpy(out + 8, &normal, 4);
+    }
+    return packed;
+}
+
+/// Marca o fim de uma lista de vértices em VertexDedup.
+static const uint32_t NO_VERTEX = UINT32_MAX;
+
+/// Junta os cantos de face que repetem o mesmo par (posição, normal) num vértice só.
+///
+/// Os vértices com a mesma posição formam uma lista ligada, onde a normal é procurada. Ocupa
+/// 4 bytes por posição e 8 por vértice, bem menos que um mapa de hash.
+class VertexDedup {
+  public:
+    explicit VertexDedup(size_t position_count) : first(position_count, NO_VERTEX) {}
+
+    /// Retorna o índice do vértice com a posição `v` e a normal `vn`, criando-o se preciso.
+    uint32_t find(int v, int vn, bool &created) {
+        uint32_t *link = &first[v];
+        while (*link != NO_VERTEX) {
+            if (normal_of[*link] == vn) {
+                created = false;
+                return *link;
+            }
+            link = &next[*link];
+        }
+        uint32_t index = normal_of.size();
+        *link = index;
+        normal_of.push_back(vn);
+        next.push_back(NO_VERTEX);
+        created = true;
+        return index;
+    }
+
+  private:
+    /// Primeiro vértice de cada posição.
+    std::vector<uint32_t> first;
+    /// Próximo vértice com a mesma posição, e a normal de cada vértice.
+    std::vector<uint32_t> next;
+    std::vector<int> normal_of;
+};
+
+/// Acrescenta a `vertices` o vértice com a posição `v` e a normal `vn`. Sem normal (`vn`
+/// negativo), a normal fica zerada.
+static void appendVertex(std::vector<float> &vertices, const float *positions,
+                         const float *normals, int v, int vn) {
+    const float *p = positions + 3 * size_t(v);
+    vertices.insert(vertices.end(), p, p + 3);
+    if (vn >= 0) {
+        const float *n = normals + 3 * size_t(vn);
+        vertices.insert(vertices.end(), n, n + 3);
+    } else {
+        vertices.insert(vertices.end(), 3, 0.0f);
+    }
+}
+
+/// Converte o OBJ lido em vértices sem repetição e índices.
+static void buildIndexed(const tinyobj::attrib_t &attrib,
+                         const std::vector<tinyobj::shape_t> &shapes, std::vector<float> &vertices,
+                         std::vector<uint32_t> &indices) {
+    size_t corner_count = 0;
+    for (auto &shape : shapes) {
+        corner_count += shape.mesh.indices.size();
+    }
+
+    // Cada par (posição, normal) distinto vira um vértice; os cantos das faces viram índices.
+    // Normalmente há por volta de um vértice por posição.
+    VertexDedup unique(attrib.vertices.size() / 3);
+    indices.reserve(corner_count);
+    vertices.reserve(attrib.vertices.size() * 2);
+
+    // Loop over shapes
+    for (size_t s = 0; s < shapes.size(); s++) {
+        // Loop over faces(polygon)
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
+            size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
+
+            // Loop over vertices in the face.
+            for (size_t v = 0; v < fv; v++) {
+                // access to vertex
+                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+                bool created;
+                indices.push_back(unique.find(idx.vertex_index, idx.normal_index, created));
+                if (created) {
+                    appendVertex(vertices, attrib.vertices.data(), attrib.normals.data(),
+                                 idx.vertex_index, idx.normal_index);
+                }
+            }
+            index_offset += fv;
+        }
+    }
+}
+
+/// Um std::streambuf que lê direto de um bloco de memória, sem copiá-lo.
+struct MemoryBuffer : std::streambuf {
+    MemoryBuffer(const char *data, size_t size) {
+        char *p = const_cast<char *>(data);
+        setg(p, p, p + size);
+    }
+};
+
+/// Estado da leitura com tinyobj::LoadObjWithCallback.
+struct StreamingObj {
+    /// Se é a primeira passada, que só conta os elementos do arquivo.
+    bool counting = true;
+    size_t position_count = 0;
+    size_t normal_count = 0;
+    size_t triangle_count = 0;
+
+    /// Posições e normais lidas até agora, na segunda passada.
+    std::vector<float> positions;
+    std::vector<float> normals;
+    size_t positions_seen = 0;
+    size_t normals_seen = 0;
+
+    /// Saída da segunda passada.
+    std::vector<float> *vertices = nullptr;
+    std::vector<uint32_t> *indices = nullptr;
+    VertexDedup unique{0};
+    /// Se alguma face tinha um índice fora do arquivo.
+    bool bad_index = false;
+    /// Índices da face atual, a partir de 0.
+    std::vector<int> face_positions;
+    std::vector<int> face_normals;
+    /// Cantos dos triângulos da face atual.
+    std::vector<int> face_triangles;
+};
+
+static void streamingVertex(void *user_data, tinyobj::real_t x, tinyobj::real_t y,
+                            tinyobj::real_t z, tinyobj::real_t) {
+    StreamingObj &obj = *(StreamingObj *)user_data;
+    if (obj.counting) {
+        obj.position_count++;
+        return;
+    }
+    float *p = &obj.positions[3 * obj.positions_seen++];
+    p[0] = x;
+    p[1] = y;
+    p[2] = z;
+}
+
+static void streamingNormal(void *user_data, tinyobj::real_t x, tinyobj::real_t y,
+                            tinyobj::real_t z) {
+    StreamingObj &obj = *(StreamingObj *)user_data;
+    if (obj.counting) {
+        obj.normal_count++;
+        return;
+    }
+    float *n = &obj.normals[3 * obj.normals_seen++];
+    n[0] = x;
+    n[1] = y;
+    n[2] = z;
+}
+
+/// Converte um índice do OBJ, que começa em 1 ou é negativo e relativo ao fim, num índice a partir
+/// de 0. O índice 0, que o tinyobj usa quando ele não foi dado, vira -1.
+static int resolveIndex(int raw, size_t seen) {
+    if (raw > 0)
+        return raw - 1;
+    if (raw < 0)
+        return int(seen) + raw;
+    return -1;
+}
+
+static void streamingFace(void *user_data, tinyobj::index_t *face, int count) {
+    StreamingObj &obj = *(StreamingObj *)user_data;
+    if (count < 3)
+        return;
+    if (obj.counting) {
+        obj.triangle_count += count - 2;
+        return;
+    }
+
+    std::vector<int> &v = obj.face_positions;
+    std::vector<int> &vn = obj.face_normals;
+    v.resize(count);
+    vn.resize(count);
+    for (int k = 0; k < count; k++) {
+        v[k] = resolveIndex(face[k].vertex_index, obj.positions_seen);
+        vn[k] = resolveIndex(face[k].normal_index, obj.normals_seen);
+        if (v[k] < 0 || size_t(v[k]) >= obj.position_count ||
+            size_t(vn[k] + 1) > obj.normal_count) {
+            obj.bad_index = true;
+            return;
+        }
+    }
+
+    auto corner = [&](int k) {
+        bool created;
+        obj.indices->push_back(obj.unique.find(v[k], vn[k], created));
+        if (created)
+            appendVertex(*obj.vertices, obj.positions.data(), obj.normals.data(), v[k], vn[k]);
+    };
+    // Triangula como o obj_parser e o tinyobj.
+    triangulatePolygon(obj.positions, v.data(), count, obj.face_triangles);
+    for (int k : obj.face_triangles)
+        corner(k);
+}
+
+/// Lê o OBJ `path` com o tinyobj::LoadObjWithCallback, direto para `vertices` e `indices`.
+///
+/// Não guarda o attrib_t e os shape_t inteiros: uma primeira passada conta as posições, normais e
+/// triângulos, e a segunda escreve nos vetores já alocados. Além da saída, só as posições e normais
+/// ficam na memória.
+static bool readStreaming(const char *path, std::vector<float> &vertices,
+                          std::vector<uint32_t> &indices) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Cannot open file [" << path << "]" << std::endl;
+        return false;
+    }
+
+    tinyobj::callback_t callback;
+    callback.vertex_cb = streamingVertex;
+    // O construtor do callback_t não inicializa este.
+    callback.vertex_color_cb = NULL;
+    callback.normal_cb = streamingNormal;
+    callback.index_cb = streamingFace;
+
+    StreamingObj obj;
+    obj.vertices = &vertices;
+    obj.indices = &indices;
+    std::string warn, err;
+    for (int pass = 0; pass < 2; pass++) {
+        MemoryBuffer buffer(file.data(), file.size());
+        std::istream stream(&buffer);
+        if (!tinyobj::LoadObjWithCallback(stream, callback, &obj, NULL, &warn, &err)) {
+            std::cerr << "TinyObjReader: " << err;
+            return false;
+        }
+
+        if (obj.counting) {
+            obj.counting = false;
+            obj.positions.resize(3 * obj.position_count);
+            obj.normals.resize(3 * obj.normal_count);
+            obj.unique = VertexDedup(obj.position_count);
+            indices.reserve(3 * obj.triangle_count);
+            vertices.reserve(6 * obj.position_count);
+        }
+    }
+
+    if (obj.bad_index) {
+        std::cerr << "TinyObjReader: face index out of range in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Mesh loadModel(const char *path, ObjLoader loader, bool use_cache) {
+    TRACE_SCOPE("loadModel");
+    ALLOC_SCOPE(ALLOC_LOADER);
+    Mesh mesh;
+    if (use_cache && openMeshCache(path, mesh)) {
+        return mesh;
+    }
+
+    if (loader == OBJ_LOADER_AUTO) {
+        struct stat st;
+        bool large = stat(path, &st) == 0 && (uint64_t)st.st_size >= STREAMING_MIN_OBJ_SIZE;
+        loader = large ? OBJ_LOADER_STREAMING : OBJ_LOADER_PARALLEL;
+    }
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+
+    if (loader == OBJ_LOADER_STREAMING) {
+        if (!readStreaming(path, vertices, indices)) {
+            return mesh;
+        }
+    } else {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+
+        bool loaded = false;
+        if (loader == OBJ_LOADER_FAST || loader == OBJ_LOADER_PARALLEL) {
+            std::string err;
+            int threads = loader == OBJ_LOADER_PARALLEL ? 0 : 1;
+            loaded = parseObjFile(path, attrib, shapes, err, threads);
+            if (!loaded) {
+                // O tinyobj aceita mais variações do formato; tenta com ele antes de desistir.
+                std::cerr << "ObjParser: " << err << ", falling back to tinyobj" << std::endl;
+            }
+        }
+        if (!loaded && !readWithTinyObj(path, attrib, shapes)) {
+            return mesh;
+        }
+
+        buildIndexed(attrib, shapes, vertices, indices);
+    }
+    if (indices.empty()) {
+        std::cerr << path << ": no triangles" << std::endl;
+        return mesh;
+    }
+
+    // Cada nível de detalhe tem metade dos triângulos do anterior, até a simplificação não
+    // conseguir mais reduzir o modelo, o nível ficar com menos de MIN_LOD_TRIANGLES ou o erro
+    // passar de MAX_LOD_ERROR. Cada nível é simplificado a partir do anterior, que já é menor, e o
+    // seu erro em relação ao original é limitado pela soma dos erros da cadeia.
+    glm::vec3 low(INFINITY), high(-INFINITY);
+    for (size_t v = 0; v < vertices.size(); v += 6) {
+        glm::vec3 p(vertices[v], vertices[v + 1], vertices[v + 2]);
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+    float max_error = MAX_LOD_ERROR * glm::length(high - low);
+    std::vector<std::vector<uint32_t>> levels;
+    std::vector<float> errors;
+    levels.push_back(std::move(indices));
+    errors.push_back(0.0f);
+    while (levels.size() < MAX_MESH_LODS) {
+        size_t target = levels.back().size() / 6 * 3;
+        float error;
+        std::vector<uint32_t> simpler = simplifyMesh(vertices, 6, levels.back(), target, error);
+        if (simpler.size() < 3 * MIN_LOD_TRIANGLES ||
+            simpler.size() > levels.back().size() * 3 / 4 || errors.back() + error > max_error)
+            break;
+        levels.push_back(std::move(simpler));
+        errors.push_back(errors.back() + error);
+    }
+
+    // A ordem das faces no OBJ raramente aproveita o cache de vértices da GPU.
+    size_t vertex_count = vertices.size() / 6;
+    float acmr_before = computeAcmr(levels[0], vertex_count);
+    std::vector<MeshLod> lods;
+    size_t total_indices = 0;
+    for (auto &level : levels) {
+        total_indices += level.size();
+    }
+    indices.clear();
+    indices.reserve(total_indices);
+    for (size_t l = 0; l < levels.size(); l++) {
+        optimizeVertexCache(levels[l], vertex_count);
+        lods.push_back(MeshLod{(uint32_t)indices.size(), (uint32_t)levels[l].size(), errors[l]});
+        indices.insert(indices.end(), levels[l].begin(), levels[l].end());
+    }
+    float acmr_after = computeAcmr(levels[0], vertex_count);
+    optimizeVertexFetch(vertices, indices, 6);
+    printf("%s: %zu vertices, %zu triangles, ACMR %.3f -> %.3f\n", path, vertex_count,
+           levels[0].size() / 3, acmr_before, acmr_after);
+    for (size_t l = 1; l < lods.size(); l++) {
+        printf("%s: LOD %zu, %u triangles, error %.4f\n", path, l, lods[l].index_count / 3,
+               lods[l].error);
+    }
+
+    mesh.setData(std::move(vertices), indices);
+    mesh.setLods(std::move(lods));
+
+    if (use_cache && !writeMeshCache(path, mesh)) {
+        std::cerr << "Could not write mesh cache " << meshCachePath(path) << std::endl;
+    }
+
+    return mesh;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file model.h
+ * Carregamento dos modelos desenhados na cena.
+ */
+
+#pragma once
+
+#include "mapped_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// Qual leitor de OBJ usar.
+enum ObjLoader {
+    /// O leitor de obj_parser.h, com o tinyobj como alternativa se ele falhar.
+    OBJ_LOADER_FAST,
+    /// O mesmo, lendo arquivos grandes com um thread por núcleo.
+    OBJ_LOADER_PARALLEL,
+    /// Somente o tinyobj::ObjReader.
+    OBJ_LOADER_TINYOBJ,
+    /// O tinyobj::LoadObjWithCallback, sem guardar o OBJ inteiro: usa menos memória em arquivos
+    /// grandes, mas lê o arquivo duas vezes.
+    OBJ_LOADER_STREAMING,
+    /// OBJ_LOADER_PARALLEL, ou OBJ_LOADER_STREAMING em arquivos com pelo menos
+    /// STREAMING_MIN_OBJ_SIZE bytes, onde o pico de memória pesa mais que a segunda leitura.
+    OBJ_LOADER_AUTO,
+};
+
+/// Menor OBJ lido com OBJ_LOADER_STREAMING por OBJ_LOADER_AUTO.
+const size_t STREAMING_MIN_OBJ_SIZE = 256 * 1024 * 1024;
+
+/// Número máximo de níveis de detalhe de um modelo, contando o original.
+const int MAX_MESH_LODS = 4;
+
+/// Um nível de detalhe: um trecho dos índices de uma Mesh.
+struct MeshLod {
+    /// Primeiro índice e número de índices do nível.
+    uint32_t index_offset;
+    uint32_t index_count;
+    /// Quanto a superfície do nível se afasta da original, no espaço do modelo.
+    float error;
+};
+
+/// Os triângulos indexados de um modelo.
+///
+/// Cada vértice tem posição e normal intercaladas (6 floats), sem repetição; os triângulos são
+/// dados por índices de 16 bits, quando há até 65536 vértices, ou de 32 bits. Os dados ficam em
+/// vetores próprios ou mapeados direto do arquivo de cache.
+///
+/// Os índices podem ter vários níveis de detalhe em sequência, todos usando os mesmos vértices;
+/// o primeiro é o modelo completo.
+class Mesh {
+  public:
+    const float *vertices() const { return vertex_data; }
+    size_t vertexCount() const { return vertex_count; }
+    /// Tamanho dos vértices, em bytes.
+    size_t vertexBytes() const { return vertex_count * 6 * sizeof(float); }
+
+    const void *indices() const { return index_data; }
+    size_t indexCount() const { return index_count; }
+    /// Tamanho de cada índice, em bytes: 2 ou 4.
+    size_t indexSize() const { return index_size; }
+    size_t indexBytes() const { return index_count * index_size; }
+
+    /// Os níveis de detalhe, do mais detalhado ao mais simples.
+    const std::vector<MeshLod> &lods() const { return lod_table; }
+
+    /// Passa a usar `vertices`, e uma cópia de `indices` no menor tipo que comporta os índices.
+    /// Todos os índices formam um só nível de detalhe.
+    void setData(std::vector<float> &&vertices, const std::vector<uint32_t> &indices);
+    /// Passa a usar dados guardados em `file`: `vertices` vértices a partir do byte
+    /// `vertex_offset` e `indices` índices de `index_bytes` bytes a partir de `index_offset`.
+    void setMapped(MappedFile &&file, size_t vertex_offset, size_t vertices, size_t index_offset,
+                   size_t indices, size_t index_bytes);
+    /// Passa a usar dados que não pertencem à Mesh e existem durante todo o programa, como os
+    /// embutidos no executável (veja embedded_mesh.h).
+    void setStatic(const float *vertices, size_t vertices_count, const void *indices,
+                   size_t indices_count, size_t index_bytes);
+    /// Divide os índices em níveis de detalhe.
+    void setLods(std::vector<MeshLod> &&lods) { lod_table = std::move(lods); }
+
+  private:
+    std::vector<float> vertex_storage;
+    std::vector<unsigned char> index_storage;
+    MappedFile mapping;
+    const float *vertex_data = nullptr;
+    size_t vertex_count = 0;
+    const void *index_data = nullptr;
+    size_t index_count = 0;
+    size_t index_size = 2;
+    std::vector<MeshLod> lod_table;
+};
+
+/// Tamanho de um vértice no formato compacto: a posição em 3 half floats, 2 bytes de
+/// alinhamento e a normal em GL_INT_2_10_10_10_REV, metade dos 24 bytes do formato em floats.
+const size_t COMPACT_VERTEX_SIZE = 12;
+
+/// Converte os vértices de `mesh` para o formato compacto.
+std::vector<unsigned char> packCompactVertices(const Mesh &mesh);
+
+/// Lê o modelo `path`.
+///
+/// Se `use_cache` for verdadeiro, usa o cache binário ao lado do OBJ quando ele estiver
+/// atualizado, e o cria quando não estiver (veja mesh_cache.h).
+///
+/// Retorna uma Mesh vazia, depois de mostrar o motivo, se o arquivo não puder ser lido ou não tiver
+/// triângulos. Não encerra o programa, já que pode rodar num thread separado.
+Mesh loadModel(const char *path, ObjLoader loader = OBJ_LOADER_AUTO, bool use_cache = true);
@@ -0,0 +1,109 @@
+/**
+ * @file obj2cpp.cpp
+ * Converte modelos OBJ em arrays constexpr, para embuti-los no executável.
+ *
+ * Uso: `obj2cpp SAIDA.h ARQUIVO.obj...`. Cada OBJ é processado pelo loadModel (vértices sem
+ * repetição, reordenação para o cache e níveis de detalhe) e escrito em SAIDA.h, com uma tabela
+ * `embedded_meshes` lida pelo openEmbeddedMesh.
+ *
+ * SAIDA.h é escrito num arquivo temporário e renomeado no fim, para que uma falha no meio não deixe
+ * um cabeçalho pela metade que o make consideraria atualizado.
+ */
+
+#include "model.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// Nome de identificador C++ derivado do caminho `path`.
+static std::string identifier(const char *path) {
+    std::string name = "mesh_";
+    for (const char *c = path; *c; c++) {
+        name += isalnum((unsigned char)*c) ? *c : '_';
+    }
+    return name;
+}
+
+/// Escreve os arrays do modelo `mesh`, com o prefixo `name`.
+static void writeMesh(FILE *out, const std::string &name, const Mesh &mesh) {
+    fprintf(out, "constexpr float %s_vertices[] = {\n", name.c_str());
+    for (size_t v = 0; v < mesh.vertexCount(); v++) {
+        const float *p = mesh.vertices() + 6 * v;
+        fprintf(out, "    %.9g, %.9g, %.9g, %.9g, %.9g, %.9g,\n", p[0], p[1], p[2], p[3], p[4],
+                p[5]);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "constexpr %s %s_indices[] = {", mesh.indexSize() == 2 ? "uint16_t" : "uint32_t",
+            name.c_str());
+    for (size_t i = 0; i < mesh.indexCount(); i++) {
+        uint32_t index = mesh.indexSize() == 2 ? ((const uint16_t *)mesh.indices())[i]
+                                               : ((const uint32_t *)mesh.indices())[i];
+        fprintf(out, "%s%u,", i % 16 == 0 ? "\n    " : " ", index);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "constexpr MeshLod %s_lods[] = {\n", name.c_str());
+    for (const MeshLod &lod : mesh.lods()) {
+        fprintf(out, "    {%u, %u, %.9g},\n", lod.index_offset, lod.index_count, lod.error);
+    }
+    fprintf(out, "};\n\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s OUTPUT.h FILE.obj...\n", argv[0]);
+        return 1;
+    }
+
+    std::string temp = std::string(argv[1]) + ".tmp";
+    FILE *out = fopen(temp.c_str(), "w");
+    if (!out) {
+        perror(temp.c_str());
+        return 1;
+    }
+
+    fprintf(out, "// Gerado pelo obj2cpp. Não edite.\n\n");
+    fprintf(out, "#pragma once\n\n");
+    fprintf(out, "#include \"embedded_mesh.h\"\n\n");
+    fprintf(out, "#include <stdint.h>\n\n");
+
+    std::vector<std::string> names;
+    std::vector<Mesh> meshes;
+    for (int i = 2; i < argc; i++) {
+        names.push_back(identifier(argv[i]));
+        meshes.push_back(loadModel(argv[i], OBJ_LOADER_FAST, false));
+        if (meshes.back().indexCount() == 0) {
+            fclose(out);
+            remove(temp.c_str());
+            return 1;
+        }
+        writeMesh(out, names.back(), meshes.back());
+    }
+
+    fprintf(out, "constexpr EmbeddedMesh embedded_meshes[] = {\n");
+    for (int i = 2; i < argc; i++) {
+        const std::string &name = names[i - 2];
+        const Mesh &mesh = meshes[i - 2];
+        fprintf(out, "    {\"%s\", %s_vertices, %zu, %s_indices, %zu, %zu, %s_lods, %zu},\n",
+                argv[i], name.c_str(), mesh.vertexCount(), name.c_str(), mesh.indexCount(),
+                mesh.indexSize(), name.c_str(), mesh.lods().size());
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "constexpr size_t embedded_mesh_count = %d;\n", argc - 2);
+
+    if (fclose(out) != 0) {
+        perror(temp.c_str());
+        remove(temp.c_str());
+        return 1;
+    }
+    remove(argv[1]);
+    if (rename(temp.c_str(), argv[1]) != 0) {
+        perror(argv[1]);
+        remove(temp.c_str());
+        return 1;
+    }
+    return 0;
+}
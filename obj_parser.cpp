@@ -0,0 +1,589 @@
+/**
+ * @file obj_parser.cpp
+ * Leitor rápido de arquivos OBJ.
+ */
+
+#include "obj_parser.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string.h>
+#include <thread>
+
+/// Tamanho mínimo de cada pedaço lido por um thread.
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+namespace {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+inline void skipSpaces(const char *&p, const char *end) {
+    while (p < end && isSpace(*p))
+        p++;
+}
+
+inline bool parseReal(const char *&p, const char *end, tinyobj::real_t &out) {
+    skipSpaces(p, end);
+    // from_chars não aceita o sinal '+'.
+    if (p < end && *p == '+')
+        p++;
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+inline bool parseInt(const char *&p, const char *end, int &out) {
+    if (p < end && *p == '+')
+        p++;
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+/// Bits de ObjChunk::Relative::mask: quais índices de um vértice de face são relativos.
+enum { RELATIVE_VERTEX = 1, RELATIVE_TEXCOORD = 2, RELATIVE_NORMAL = 4 };
+
+/// Converte um índice do OBJ para a partir de 0.
+///
+/// Índices negativos são relativos ao fim da lista lida até aqui. Como o pedaço do arquivo pode
+/// não começar no início, eles são convertidos usando apenas a contagem local `count`, e marcados
+/// em `relative` para somar depois a contagem dos pedaços anteriores.
+inline bool fixIndex(int index, size_t count, int &out, unsigned char &relative,
+                     unsigned char bit) {
+    if (index > 0) {
+        out = index - 1;
+        return true;
+    }
+    if (index < 0) {
+        out = (int)count + index;
+        relative |= bit;
+        return true;
+    }
+    return false;
+}
+
+/// Lê um vértice de face no formato `v`, `v/vt`, `v//vn` ou `v/vt/vn`.
+inline bool parseCorner(const char *&p, const char *end, const tinyobj::attrib_t &attrib,
+                        tinyobj::index_t &out, unsigned char &relative) {
+    out.vertex_index = out.texcoord_index = out.normal_index = -1;
+    relative = 0;
+
+    int v;
+    if (!parseInt(p, end, v) ||
+        !fixIndex(v, attrib.vertices.size() / 3, out.vertex_index, relative, RELATIVE_VERTEX))
+        return false;
+    if (p == end || *p != '/')
+        return true;
+
+    p++;
+    if (p < end && *p != '/') {
+        int vt;
+        if (!parseInt(p, end, vt) || !fixIndex(vt, attrib.texcoords.size() / 2,
+                                               out.texcoord_index, relative, RELATIVE_TEXCOORD))
+            return false;
+    }
+    if (p == end || *p != '/')
+        return true;
+
+    p++;
+    int vn;
+    return parseInt(p, end, vn) &&
+           fixIndex(vn, attrib.normals.size() / 3, out.normal_index, relative, RELATIVE_NORMAL);
+}
+
+/// Retorna o resto da linha sem os espaços das pontas.
+inline std::string restOfLine(const char *p, const char *end) {
+    skipSpaces(p, end);
+    while (end > p && isSpace(end[-1]))
+        end--;
+    return std::string(p, end);
+}
+
+/// Se o ponto (`x`, `y`) está dentro do triângulo de cantos (`tx[k]`, `ty[k]`). O mesmo teste do
+/// pnpoly do tinyobj, para a triangulação dar os mesmos triângulos.
+inline bool insideTriangle(const tinyobj::real_t *tx, const tinyobj::real_t *ty, tinyobj::real_t x,
+                           tinyobj::real_t y) {
+    bool inside = false;
+    for (int i = 0, j = 2; i < 3; j = i++) {
+        if ((ty[i] > y) != (ty[j] > y) &&
+            x < (tx[j] - tx[i]) * (y - ty[i]) / (ty[j] - ty[i]) + tx[i])
+            inside = !inside;
+    }
+    return inside;
+}
+
+/// Divide os polígonos com mais de três vértices em triângulos, com triangulatePolygon.
+void triangulate(tinyobj::mesh_t &mesh, const std::vector<tinyobj::real_t> &v) {
+    bool all_triangles = true;
+    for (unsigned int n : mesh.num_face_vertices) {
+        if (n != 3) {
+            all_triangles = false;
+            break;
+        }
+    }
+    if (all_triangles)
+        return;
+
+    std::vector<tinyobj::index_t> indices;
+    decltype(mesh.num_face_vertices) num_face_vertices;
+    std::vector<int> material_ids;
+    decltype(mesh.smoothing_group_ids) smoothing_group_ids;
+    indices.reserve(mesh.indices.size() * 2);
+
+    std::vector<int> corners, triangles;
+    size_t offset = 0;
+    for (size_t f = 0; f < mesh.num_face_vertices.size(); f++) {
+        unsigned int n = mesh.num_face_vertices[f];
+        const tinyobj::index_t *face = &mesh.indices[offset];
+        offset += n;
+
+        corners.resize(n);
+        for (unsigned int k = 0; k < n; k++)
+            corners[k] = face[k].vertex_index;
+        triangulatePolygon(v, corners.data(), n, triangles);
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            indices.push_back(face[triangles[t]]);
+            indices.push_back(face[triangles[t + 1]]);
+            indices.push_back(face[triangles[t + 2]]);
+            num_face_vertices.push_back(3);
+            material_ids.push_back(mesh.material_ids[f]);
+            smoothing_group_ids.push_back(mesh.smoothing_group_ids[f]);
+        }
+    }
+
+    mesh.indices.swap(indices);
+    mesh.num_face_vertices.swap(num_face_vertices);
+    mesh.material_ids.swap(material_ids);
+    mesh.smoothing_group_ids.swap(smoothing_group_ids);
+}
+
+/// O resultado da leitura de um pedaço do arquivo, que começa e termina numa quebra de linha.
+struct ObjChunk {
+    /// Trecho contínuo de faces de um shape.
+    struct Segment {
+        /// Se o trecho começa numa linha `o` ou `g`. Só o primeiro trecho do pedaço não começa, e
+        /// continua o shape que estava aberto no fim do pedaço anterior.
+        bool named;
+        std::string name;
+        std::vector<tinyobj::index_t> indices;
+        std::vector<unsigned char> face_sizes;
+    };
+
+    /// Um vértice de face com algum índice negativo.
+    struct Relative {
+        size_t segment;
+        size_t corner;
+        unsigned char mask;
+        int line;
+    };
+
+    /// Os `v`, `vn` e `vt` deste pedaço.
+    tinyobj::attrib_t attrib;
+    std::vector<Segment> segments;
+    std::vector<Relative> relative;
+    /// Número de linhas do pedaço.
+    int lines = 0;
+    /// A linha, contada a partir do início do pedaço, do primeiro erro, ou 0.
+    int error_line = 0;
+};
+
+/// Lê as linhas de [begin, end).
+void parseChunk(const char *begin, const char *end, ObjChunk &chunk) {
+    tinyobj::attrib_t &attrib = chunk.attrib;
+    chunk.segments.emplace_back();
+    chunk.segments.back().named = false;
+
+    const char *p = begin;
+    int line_number = 0;
+
+    while (p < end) {
+        line_number++;
+        const char *line_end = (const char *)memchr(p, '\n', end - p);
+        const char *next = line_end ? line_end + 1 : end;
+        if (!line_end)
+            line_end = end;
+        if (line_end > p && line_end[-1] == '\r')
+            line_end--;
+
+        skipSpaces(p, line_end);
+        bool ok = true;
+
+        if (line_end - p >= 2 && p[0] == 'v' && isSpace(p[1])) {
+            p += 2;
+            tinyobj::real_t x, y, z;
+            ok = parseReal(p, line_end, x) && parseReal(p, line_end, y) &&
+                 parseReal(p, line_end, z);
+            attrib.vertices.push_back(x);
+            attrib.vertices.push_back(y);
+            attrib.vertices.push_back(z);
+        } else if (line_end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+            p += 3;
+            tinyobj::real_t x, y, z;
+            ok = parseReal(p, line_end, x) && parseReal(p, line_end, y) &&
+                 parseReal(p, line_end, z);
+            attrib.normals.push_back(x);
+            attrib.normals.push_back(y);
+            attrib.normals.push_back(z);
+        } else if (line_end - p >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+            p += 3;
+            tinyobj::real_t u, v;
+            ok = parseReal(p, line_end, u) && parseReal(p, line_end, v);
+            attrib.texcoords.push_back(u);
+            attrib.texcoords.push_back(v);
+        } else if (line_end - p >= 2 && p[0] == 'f' && isSpace(p[1])) {
+            p += 2;
+            ObjChunk::Segment &segment = chunk.segments.back();
+            unsigned int corners = 0;
+            size_t relative = chunk.relative.size();
+            skipSpaces(p, line_end);
+            while (ok && p < line_end) {
+                tinyobj::index_t corner;
+                unsigned char mask;
+                ok = parseCorner(p, line_end, attrib, corner, mask);
+                if (mask) {
+                    chunk.relative.push_back(ObjChunk::Relative{
+                        chunk.segments.size() - 1, segment.indices.size(), mask, line_number});
+                }
+                segment.indices.push_back(corner);
+                corners++;
+                skipSpaces(p, line_end);
+            }
+            if (ok && corners < 3) {
+                // Faces degeneradas são descartadas, como no tinyobj.
+                segment.indices.resize(segment.indices.size() - corners);
+                chunk.relative.resize(relative);
+            } else if (ok) {
+                segment.face_sizes.push_back(corners);
+            }
+        } else if (line_end - p >= 1 && (p[0] == 'o' || p[0] == 'g') &&
+                   (line_end - p == 1 || isSpace(p[1]))) {
+            chunk.segments.emplace_back();
+            chunk.segments.back().named = true;
+            chunk.segments.back().name = restOfLine(p + 1, line_end);
+        }
+
+        if (!ok) {
+            chunk.error_line = line_number;
+            break;
+        }
+        p = next;
+    }
+
+    chunk.lines = line_number;
+}
+
+/// Roda `work(i)` para i em [0, count), com um thread por índice.
+template <typename F> void runParallel(int count, F work) {
+    std::vector<std::thread> workers;
+    for (int i = 1; i < count; i++)
+        workers.emplace_back(work, i);
+    work(0);
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+/// Coloca `src` em `dst` a partir de `offset`.
+///
+/// Com um pedaço só (`single`), `dst` começa vazio e o vetor é trocado em vez de copiado. Com
+/// vários, `dst` já tem o tamanho final e é compartilhado entre os threads, então cada pedaço só
+/// copia para o seu trecho, sem nunca alterar o vetor em si.
+template <typename T>
+void place(std::vector<T> &dst, std::vector<T> &src, size_t offset, bool single) {
+    if (!single)
+        std::copy(src.begin(), src.end(), dst.begin() + offset);
+    else if (dst.empty())
+        dst.swap(src);
+    else
+        dst.insert(dst.end(), src.begin(), src.end());
+}
+
+/// Junta os pedaços, na ordem do arquivo, em `attrib` e `shapes`.
+///
+/// As posições finais de cada pedaço são calculadas por somas de prefixo das contagens, e a cópia
+/// de cada pedaço para o seu lugar roda em paralelo.
+bool mergeChunks(std::vector<ObjChunk> &chunks, tinyobj::attrib_t &attrib,
+                 std::vector<tinyobj::shape_t> &shapes, std::string &err) {
+    int count = chunks.size();
+
+    // Somas de prefixo: o que vem antes de cada pedaço.
+    std::vector<size_t> vertex_offset(count + 1, 0), normal_offset(count + 1, 0),
+        texcoord_offset(count + 1, 0);
+    std::vector<int> line_offset(count + 1, 0);
+    for (int c = 0; c < count; c++) {
+        const ObjChunk &chunk = chunks[c];
+        if (chunk.error_line) {
+            err = "OBJ parse error at line " + std::to_string(line_offset[c] + chunk.error_line);
+            return false;
+        }
+        vertex_offset[c + 1] = vertex_offset[c] + chunk.attrib.vertices.size();
+        normal_offset[c + 1] = normal_offset[c] + chunk.attrib.normals.size();
+        texcoord_offset[c + 1] = texcoord_offset[c] + chunk.attrib.texcoords.size();
+        line_offset[c + 1] = line_offset[c] + chunk.lines;
+    }
+
+    // Decide em qual shape, e em que posição, cada trecho vai parar. Uma linha `o` ou `g` só
+    // começa um shape novo se o atual já tem faces; senão apenas o renomeia.
+    struct Placement {
+        size_t shape;
+        size_t index_offset;
+        size_t face_offset;
+    };
+    std::vector<std::vector<Placement>> placements(count);
+    std::vector<size_t> index_count(1, 0), face_count(1, 0);
+    shapes.assign(1, tinyobj::shape_t());
+    for (int c = 0; c < count; c++) {
+        for (ObjChunk::Segment &segment : chunks[c].segments) {
+            if (segment.named) {
+                if (index_count.back() > 0) {
+                    shapes.emplace_back();
+                    index_count.push_back(0);
+                    face_count.push_back(0);
+                }
+                shapes.back().name = segment.name;
+            }
+            placements[c].push_back(
+                Placement{shapes.size() - 1, index_count.back(), face_count.back()});
+            index_count.back() += segment.indices.size();
+            face_count.back() += segment.face_sizes.size();
+        }
+    }
+
+    // Com um pedaço só os vetores são trocados, sem cópia; com vários, cada pedaço é copiado para
+    // o seu lugar nos vetores finais.
+    attrib = tinyobj::attrib_t();
+    if (count > 1) {
+        attrib.vertices.resize(vertex_offset[count]);
+        attrib.normals.resize(normal_offset[count]);
+        attrib.texcoords.resize(texcoord_offset[count]);
+        for (size_t s = 0; s < shapes.size(); s++) {
+            shapes[s].mesh.indices.resize(index_count[s]);
+            shapes[s].mesh.num_face_vertices.resize(face_count[s]);
+        }
+    }
+
+    std::vector<int> error_lines(count, 0);
+    auto copyChunk = [&](int c) {
+        ObjChunk &chunk = chunks[c];
+        bool single = count == 1;
+        place(attrib.vertices, chunk.attrib.vertices, vertex_offset[c], single);
+        place(attrib.normals, chunk.attrib.normals, normal_offset[c], single);
+        place(attrib.texcoords, chunk.attrib.texcoords, texcoord_offset[c], single);
+
+        for (size_t s = 0; s < chunk.segments.size(); s++) {
+            ObjChunk::Segment &segment = chunk.segments[s];
+            const Placement &placement = placements[c][s];
+            tinyobj::mesh_t &mesh = shapes[placement.shape].mesh;
+            place(mesh.indices, segment.indices, placement.index_offset, single);
+            place(mesh.num_face_vertices, segment.face_sizes, placement.face_offset, single);
+        }
+
+        // Os índices negativos agora podem ser resolvidos.
+        for (const ObjChunk::Relative &relative : chunk.relative) {
+            const Placement &placement = placements[c][relative.segment];
+            tinyobj::index_t &index =
+                shapes[placement.shape].mesh.indices[placement.index_offset + relative.corner];
+            if (relative.mask & RELATIVE_VERTEX)
+                index.vertex_index += vertex_offset[c] / 3;
+            if (relative.mask & RELATIVE_TEXCOORD)
+                index.texcoord_index += texcoord_offset[c] / 2;
+            if (relative.mask & RELATIVE_NORMAL)
+                index.normal_index += normal_offset[c] / 3;
+            if (index.vertex_index < 0 || ((relative.mask & RELATIVE_TEXCOORD) &&
+                                           index.texcoord_index < 0) ||
+                ((relative.mask & RELATIVE_NORMAL) && index.normal_index < 0)) {
+                error_lines[c] = line_offset[c] + relative.line;
+                break;
+            }
+        }
+
+        chunk = ObjChunk();
+    };
+
+    runParallel(count, copyChunk);
+
+    for (tinyobj::shape_t &shape : shapes) {
+        shape.mesh.material_ids.assign(shape.mesh.num_face_vertices.size(), -1);
+        shape.mesh.smoothing_group_ids.assign(shape.mesh.num_face_vertices.size(), 0);
+    }
+
+    for (int c = 0; c < count; c++) {
+        if (error_lines[c]) {
+            err = "OBJ parse error at line " + std::to_string(error_lines[c]);
+            return false;
+        }
+    }
+
+    if (shapes.back().mesh.indices.empty())
+        shapes.pop_back();
+
+    return true;
+}
+
+} // namespace
+
+void triangulatePolygon(const std::vector<tinyobj::real_t> &v, const int *vertex_index, int count,
+                        std::vector<int> &triangles) {
+    using tinyobj::real_t;
+    triangles.clear();
+    auto valid = [&](int corner) { return 3 * size_t(vertex_index[corner]) + 2 < v.size(); };
+    auto position = [&](int corner) { return &v[3 * size_t(vertex_index[corner])]; };
+
+    if (count < 3)
+        return;
+    if (count == 3) {
+        for (int k = 0; k < 3; k++)
+            triangles.push_back(k);
+        return;
+    }
+    if (count == 4) {
+        for (int k = 0; k < 4; k++) {
+            if (!valid(k))
+                return;
+        }
+        auto sqrDistance = [&](int a, int b) {
+            real_t d = 0;
+            for (int k = 0; k < 3; k++) {
+                real_t e = position(b)[k] - position(a)[k];
+                d += e * e;
+            }
+            return d;
+        };
+        // Pela diagonal mais curta.
+        static const int DIAGONAL_02[6] = {0, 1, 2, 0, 2, 3}, DIAGONAL_13[6] = {0, 1, 3, 1, 2, 3};
+        const int *corners = sqrDistance(0, 2) < sqrDistance(1, 3) ? DIAGONAL_02 : DIAGONAL_13;
+        triangles.assign(corners, corners + 6);
+        return;
+    }
+
+    // Projeta o polígono no plano dos dois eixos em que a primeira quina não degenerada tem mais
+    // área.
+    size_t axes[2] = {1, 2};
+    for (int k = 0; k < count; k++) {
+        int c0 = k, c1 = (k + 1) % count, c2 = (k + 2) % count;
+        if (!valid(c0) || !valid(c1) || !valid(c2))
+            continue;
+        const real_t *p0 = position(c0), *p1 = position(c1), *p2 = position(c2);
+        real_t e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        real_t e1[3] = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
+        real_t cx = std::fabs(e0[1] * e1[2] - e0[2] * e1[1]);
+        real_t cy = std::fabs(e0[2] * e1[0] - e0[0] * e1[2]);
+        real_t cz = std::fabs(e0[0] * e1[1] - e0[1] * e1[0]);
+        real_t epsilon = std::numeric_limits<real_t>::epsilon();
+        if (cx > epsilon || cy > epsilon || cz > epsilon) {
+            if (!(cx > cy && cx > cz)) {
+                axes[0] = 0;
+                if (cz > cx && cz > cy)
+                    axes[1] = 1;
+            }
+            break;
+        }
+    }
+    auto inPlane = [&](int corner, real_t &x, real_t &y) {
+        size_t i = 3 * size_t(vertex_index[corner]);
+        if (i + axes[0] >= v.size() || i + axes[1] >= v.size())
+            return false;
+        x = v[i + axes[0]];
+        y = v[i + axes[1]];
+        return true;
+    };
+
+    // Recorta orelhas: o triângulo de três cantos seguidos, se ele é convexo e não contém outro
+    // canto, sai do polígono junto com o canto do meio. Desiste depois de uma volta inteira sem
+    // achar nenhuma.
+    std::vector<int> remaining(count);
+    for (int k = 0; k < count; k++)
+        remaining[k] = k;
+    size_t guess = 0;
+    size_t iterations = count;
+    size_t previous_size = count;
+    while (remaining.size() > 3 && iterations > 0) {
+        size_t n = remaining.size();
+        if (guess >= n)
+            guess -= n;
+        if (previous_size != n) {
+            previous_size = n;
+            iterations = n;
+        } else {
+            iterations--;
+        }
+
+        real_t x[3], y[3];
+        for (int k = 0; k < 3; k++) {
+            if (!inPlane(remaining[(guess + k) % n], x[k], y[k]))
+                x[k] = y[k] = 0;
+        }
+        // Como no tinyobj, o sinal da quina é comparado com o da área do triângulo que a origem
+        // forma com os dois primeiros cantos.
+        real_t cross = (x[1] - x[0]) * (y[2] - y[1]) - (y[1] - y[0]) * (x[2] - x[1]);
+        real_t area = (x[0] * y[1] - y[0] * x[1]) * real_t(0.5);
+        if (cross * area < 0) {
+            guess++;
+            continue;
+        }
+
+        bool overlap = false;
+        for (size_t other = 3; other < n; other++) {
+            real_t ox, oy;
+            if (inPlane(remaining[(guess + other) % n], ox, oy) && insideTriangle(x, y, ox, oy)) {
+                overlap = true;
+                break;
+            }
+        }
+        if (overlap) {
+            guess++;
+            continue;
+        }
+
+        for (int k = 0; k < 3; k++)
+            triangles.push_back(remaining[(guess + k) % n]);
+        remaining.erase(remaining.begin() + (guess + 1) % n);
+    }
+    if (remaining.size() == 3)
+        triangles.insert(triangles.end(), remaining.begin(), remaining.end());
+}
+
+bool parseObj(const char *data, size_t size, tinyobj::attrib_t &attrib,
+              std::vector<tinyobj::shape_t> &shapes, std::string &err, int threads) {
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // Dividir um arquivo pequeno custa mais do que lê-lo.
+    threads = std::max<size_t>(1, std::min<size_t>(threads, size / MIN_CHUNK_SIZE));
+
+    // Divide o arquivo em pedaços de tamanho parecido, sempre logo depois de uma quebra de linha.
+    std::vector<const char *> bounds(threads + 1);
+    bounds[0] = data;
+    bounds[threads] = data + size;
+    for (int i = 1; i < threads; i++) {
+        const char *p = std::max(bounds[i - 1], data + size * i / threads);
+        const char *newline = (const char *)memchr(p, '\n', data + size - p);
+        bounds[i] = newline ? newline + 1 : data + size;
+    }
+
+    std::vector<ObjChunk> chunks(threads);
+    runParallel(threads, [&](int i) { parseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+
+    if (!mergeChunks(chunks, attrib, shapes, err))
+        return false;
+
+    for (tinyobj::shape_t &shape : shapes)
+        triangulate(shape.mesh, attrib.vertices);
+
+    return true;
+}
+
+bool parseObjFile(const char *path, tinyobj::attrib_t &attrib,
+                  std::vector<tinyobj::shape_t> &shapes, std::string &err, int threads) {
+    MappedFile file;
+    if (!file.open(path)) {
+        err = std::string("Cannot open file [") + path + "]";
+        return false;
+    }
+    return parseObj(file.data(), file.size(), attrib, shapes, err, threads);
+}
@@ -0,0 +1,44 @@
+/**
+ * @file obj_parser.h
+ * Leitor rápido de arquivos OBJ.
+ *
+ * Alternativa ao tinyobj::LoadObj para malhas grandes: o arquivo é mapeado em memória, as
+ * linhas são encontradas com memchr e os números convertidos com std::from_chars, sem alocar
+ * nada por linha. A saída usa as mesmas estruturas do tinyobj, com os polígonos triangulados.
+ *
+ * Lê apenas `v`, `vn`, `vt`, `f`, `o` e `g`. Materiais e as demais linhas são ignorados.
+ *
+ * Arquivos grandes podem ser lidos por vários threads: o arquivo é dividido em pedaços nas
+ * quebras de linha, cada pedaço é lido separadamente, e os resultados são juntados. A saída é a
+ * mesma da leitura com um thread só.
+ */
+
+#pragma once
+
+#include "tiny_obj_loader.h"
+
+#include <string>
+#include <vector>
+
+/// Triangula um polígono de `count` cantos como o tinyobj::LoadObj: quadriláteros pela diagonal
+/// mais curta, e polígonos maiores recortando orelhas, para que os leitores deem os mesmos
+/// triângulos para o mesmo arquivo.
+///
+/// @param v As posições, três coordenadas cada.
+/// @param vertex_index A posição de cada canto.
+/// @param triangles Recebe os cantos (de 0 a `count - 1`) de cada triângulo, de três em três.
+void triangulatePolygon(const std::vector<tinyobj::real_t> &v, const int *vertex_index, int count,
+                        std::vector<int> &triangles);
+
+/// Lê um OBJ que já está em memória.
+///
+/// @param threads Número de threads; 0 usa um por núcleo. Arquivos pequenos são lidos com menos.
+/// @return false, com a mensagem em `err`, se o arquivo está malformado.
+bool parseObj(const char *data, size_t size, tinyobj::attrib_t &attrib,
+              std::vector<tinyobj::shape_t> &shapes, std::string &err, int threads = 1);
+
+/// Mapeia e lê o OBJ `path`.
+///
+/// @return false, com a mensagem em `err`, se o arquivo não existe ou está malformado.
+bool parseObjFile(const char *path, tinyobj::attrib_t &attrib,
+                  std::vector<tinyobj::shape_t> &shapes, std::string &err, int threads = 1);
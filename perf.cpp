@@ -0,0 +1,72 @@
+/**
+ * @file perf.cpp
+ * Contadores leves de desempenho, mostrados no HUD.
+ */
+
+#include "perf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+bool perf_enabled = false;
+FrameCounters frame_counters;
+
+void TimeWindow::add(double ms) {
+    values[next] = ms;
+    next = (next + 1) % SIZE;
+    count = std::min(count + 1, SIZE);
+}
+
+SampleStats TimeWindow::stats() const {
+    // Copiado para a pilha, para não alocar a cada quadro.
+    double sorted[SIZE];
+    std::copy(values, values + count, sorted);
+    return sampleStats(sorted, count);
+}
+
+SampleStats sampleStats(double *samples, size_t count) {
+    SampleStats stats = {};
+    if (count == 0)
+        return stats;
+    std::sort(samples, samples + count);
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++)
+        sum += samples[i];
+    stats.mean = sum / count;
+    stats.p50 = samples[(count - 1) * 50 / 100];
+    stats.p95 = samples[(count - 1) * 95 / 100];
+    stats.p99 = samples[(count - 1) * 99 / 100];
+    stats.max = samples[count - 1];
+    return stats;
+}
+
+SampleStats sampleStats(std::vector<double> &samples) {
+    return sampleStats(samples.data(), samples.size());
+}
+
+double perfNow() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+double perfThreadCpuNow() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    // Em unidades de 100 ns.
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) / 1e4;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+#endif
+}
@@ -0,0 +1,89 @@
+/**
+ * @file perf.h
+ * Contadores leves de desempenho, mostrados no HUD.
+ *
+ * Os contadores só são atualizados quando `perf_enabled` é verdadeiro; com o HUD escondido o
+ * custo é um teste de um booleano.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+/// Contadores de um quadro.
+struct FrameCounters {
+    /// Chamadas de desenho (glDraw*).
+    int draw_calls;
+    /// Chamadas ao OpenGL feitas com GL_COUNTED, incluindo as de desenho.
+    int gl_calls;
+    /// Bytes enviados para a GPU com glBufferData/glBufferSubData.
+    size_t uploaded_bytes;
+};
+
+/// Se os contadores e os tempos devem ser coletados.
+extern bool perf_enabled;
+/// Os contadores do quadro sendo desenhado.
+extern FrameCounters frame_counters;
+
+inline void countGlCall() {
+    if (perf_enabled)
+        frame_counters.gl_calls++;
+}
+
+/// Faz a chamada ao OpenGL `call`, com o mesmo resultado, e a conta em `gl_calls`.
+///
+/// Cada chamada de um quadro é envolvida no lugar em que é feita, para que a contagem não se
+/// afaste das chamadas quando o código muda.
+#define GL_COUNTED(call) (countGlCall(), call)
+
+/// Conta um desenho, que também deve ser feito com GL_COUNTED.
+inline void countDrawCall() {
+    if (perf_enabled)
+        frame_counters.draw_calls++;
+}
+
+/// Conta `bytes` enviados; a chamada que os envia deve ser feita com GL_COUNTED.
+inline void countUpload(size_t bytes) {
+    if (perf_enabled)
+        frame_counters.uploaded_bytes += bytes;
+}
+
+/// Média e percentis de uma série de amostras.
+struct SampleStats {
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+/// Calcula as estatísticas de `samples`, que é ordenado no processo.
+///
+/// O percentil p é a amostra de índice `(count - 1) * p / 100` depois de ordenar, em todas as
+/// medições (HUD, modo sem janela e benchmarks).
+SampleStats sampleStats(double *samples, size_t count);
+SampleStats sampleStats(std::vector<double> &samples);
+
+/// Janela circular com as últimas amostras de tempo, em milissegundos.
+class TimeWindow {
+  public:
+    static constexpr int SIZE = 256;
+
+    void add(double ms);
+    void clear() { count = next = 0; }
+    /// Estatísticas das amostras na janela.
+    SampleStats stats() const;
+    int samples() const { return count; }
+
+  private:
+    double values[SIZE];
+    int count = 0;
+    int next = 0;
+};
+
+/// Retorna o tempo atual em milissegundos, de um relógio monotônico.
+double perfNow();
+
+/// Retorna o tempo de CPU usado pelo thread atual, em milissegundos.
+double perfThreadCpuNow();
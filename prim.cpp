@@ -1,21 +1,33 @@
+#include "alloc_stats.h"
+#include "embedded_mesh.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "glm/geometric.hpp"
+#include "gpu_timer.h"
+#include "graph.h"
+#include "headless.h"
+#include "hud.h"
+#include "model.h"
+#include "perf.h"
+#include "shader_reload.h"
+#include "spatial.h"
+#include "trace.h"
 #include "utils.h"
 #include <GL/freeglut.h>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vector>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 /* Globals */
 /** Window width. */
 int win_width = 600;
@@ -24,37 +36,114 @@ int win_height = 600;
 
 /** Program variable. */
 int program;
+/// Programa usado para desenhar os nós distantes como pontos.
+int point_program;
+/// Programa usado para desenhar as casinhas de todos os nós numa chamada só.
+int node_program;
+
+/// Se os vértices e os dados de cada instância usam os formatos compactos (veja
+/// COMPACT_VERTEX_SIZE e CompactNodeInstance), em vez de floats.
+bool compact_vertices = true;
+/// Diretório de onde os shaders são lidos e recarregados (`--shaders`), ou NULL para usar os
+/// embutidos.
+const char *shader_dir = NULL;
+/// Se a cena é desenhada num framebuffer fora da tela, sem janela para trocar os buffers.
+bool offscreen = false;
 
 /// Modelo de uma casinha.
 unsigned int VAO_CASA;
 unsigned int VBO_CASA;
+unsigned int EBO_CASA;
+/// Níveis de detalhe da casinha, todos no mesmo index buffer.
+std::vector<MeshLod> casa_lods;
+/// GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT, conforme o tamanho dos índices da casinha.
+unsigned int casa_index_type;
+size_t casa_index_size;
+/// Posição e cor de cada casinha desenhada, preenchido a cada quadro.
+unsigned int VBO_NOS;
+
+/// Dados de uma casinha, em floats.
+struct NodeInstance {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+/// Dados de uma casinha no formato compacto, com 12 bytes em vez de 24.
+struct CompactNodeInstance {
+    /// Posição normalizada dentro da caixa que contém todos os nós (node_origin e node_extent).
+    uint16_t position[4];
+    uint8_t color[4];
+};
+
+/// Instâncias das casinhas visíveis no quadro atual, no formato escolhido, separadas pelo nível de
+/// detalhe.
+std::vector<NodeInstance> node_instances[MAX_MESH_LODS];
+std::vector<CompactNodeInstance> compact_node_instances[MAX_MESH_LODS];
 
 /// Modelo de um cubo.
 unsigned int VAO_CUBO;
 unsigned int VBO_CUBO;
 
-/// Um nó no grafo
-struct Node {
-    /// A posição do grafo
-    glm::vec3 position;
-
-    /// Se esse nó já foi adicionado a árvore.
-    bool in_tree;
-
-    /// O indice do nó na árvore mais próximo deste.
-    int connected_to;
-    /// A distância ao nó na árvore mais próximo deste.
-    float cost;
-};
-
-/// Todos os nós do grafo.
-std::vector<Node> nodes;
-/// Os nós ainda não incluídos na árvore mínima.
-std::vector<int> not_included;
-/// O indice do último nó adicionado à àrvore mínima.
-int last_added = -1;
+/// Pontos que substituem as casinhas distantes.
+unsigned int VAO_PONTOS;
+unsigned int VBO_PONTOS;
+
+/// Distância à câmera a partir da qual um nó é desenhado como um ponto em vez de uma casinha.
+const float LOD_DISTANCE = 30.0f;
+/// Escala do modelo da casinha desenhado em cada nó.
+const float NODE_SCALE = 0.5f;
+/// Maior erro, em pixels na tela, aceito ao escolher um nível de detalhe mais simples para uma
+/// casinha.
+const float LOD_PIXEL_ERROR = 1.0f;
+/// Meia-largura e meia-altura da caixa desenhada em cada aresta.
+const float EDGE_RADIUS = 0.15f;
+const float EDGE_HEIGHT = 0.025f;
+/// Posição e cor (6 floats por nó) dos nós distantes no quadro atual.
+std::vector<float> far_points;
+
+/// Tempo de GPU de cada passe de renderização.
+GpuTimers gpu_timers;
+/// Número de quadros medidos quando as estatísticas foram impressas pela última vez.
+int last_gpu_report = 0;
+
+/// Se o HUD de desempenho está visível.
+bool hud_visible = false;
+/// Tempo de CPU de cada quadro, coletado enquanto o HUD está visível.
+TimeWindow frame_times;
+/// Texto do HUD, reaproveitado entre os quadros.
+char hud_text[1024];
 
 glm::vec3 camera_pos = glm::vec3(0.0f, 15.0f, 10.0f);
+/// Distância do plano de corte distante da projeção. O benchmark de renderização a aumenta para
+/// que o grafo inteiro caiba.
+float far_plane = 100.0f;
+
+/// Como os passos do prim são executados, além da tecla `n`.
+enum AutoRun {
+    AUTO_RUN_OFF,
+    /// A cada quadro, quantos passos couberem em `step_budget_ms`.
+    AUTO_RUN_BUDGET,
+    /// Até completar a árvore, na velocidade do prim, redesenhando a cada COMPLETE_BUDGET_MS.
+    AUTO_RUN_COMPLETE,
+};
+AutoRun auto_run = AUTO_RUN_OFF;
+/// Tempo dos passos do prim em cada quadro no modo AUTO_RUN_BUDGET, em milissegundos.
+double step_budget_ms = 4.0;
+/// Tempo dos passos do prim entre um quadro e outro no modo AUTO_RUN_COMPLETE, em milissegundos.
+const double COMPLETE_BUDGET_MS = 100.0;
+/// Passos executados na última vez que o modo automático rodou.
+int auto_run_steps = 0;
+
+/// Instante em que o programa começou, até o primeiro quadro ser desenhado; depois, negativo.
+double startup_start = -1.0;
+
+/// Inicialização que não usa o OpenGL, rodando em outros threads enquanto o contexto é criado.
+struct StartupTasks {
+    /// O modelo da casinha, já lido e otimizado.
+    std::future<Mesh> casinha;
+    /// O grafo inicial, com o primeiro passo do prim.
+    std::future<void> graph;
+};
 
 /** Vertex shader. */
 const char *vertex_code = "\n"
@@ -65,18 +154,47 @@ const char *vertex_code = "\n"
                           "uniform mat4 model;\n"
                           "uniform mat4 view;\n"
                           "uniform mat4 projection;\n"
+                          "uniform mat3 normalMatrix;\n"
+                          "uniform vec3 objectColor;\n"
                           "\n"
                           "out vec3 vNormal;\n"
                           "out vec3 fragPosition;\n"
+                          "out vec3 vColor;\n"
                           "\n"
                           "void main()\n"
                           "{\n"
                           "    gl_Position = projection * view * model * vec4(position, 1.0);\n"
-                          "    vNormal = mat3(transpose(inverse(model)))*normal;\n"
+                          "    vNormal = normalMatrix * normal;\n"
                           "    fragPosition = vec3(model * vec4(position, 1.0));\n"
+                          "    vColor = objectColor;\n"
                           "}\0";
 
-/*"    vNormal = mat3(transpose(inverse(model)))*normal;\n"*/
+/** Vertex shader das casinhas, uma instância por nó. */
+const char *node_vertex_code = "\n"
+                               "#version 330 core\n"
+                               "layout (location = 0) in vec3 position;\n"
+                               "layout (location = 1) in vec3 normal;\n"
+                               "layout (location = 2) in vec3 instancePosition;\n"
+                               "layout (location = 3) in vec3 instanceColor;\n"
+                               "\n"
+                               "uniform mat4 view;\n"
+                               "uniform mat4 projection;\n"
+                               "uniform vec3 instanceOrigin;\n"
+                               "uniform vec3 instanceExtent;\n"
+                               "uniform float nodeScale;\n"
+                               "\n"
+                               "out vec3 vNormal;\n"
+                               "out vec3 fragPosition;\n"
+                               "out vec3 vColor;\n"
+                               "\n"
+                               "void main()\n"
+                               "{\n"
+                               "    vec3 center = instanceOrigin + instanceExtent * instancePosition;\n"
+                               "    fragPosition = center + nodeScale * position;\n"
+                               "    gl_Position = projection * view * vec4(fragPosition, 1.0);\n"
+                               "    vNormal = normal;\n"
+                               "    vColor = instanceColor;\n"
+                               "}\0";
 
 /** Fragment shader. */
 const char *fragment_code = "\n"
@@ -84,10 +202,10 @@ const char *fragment_code = "\n"
                             "\n"
                             "in vec3 vNormal;\n"
                             "in vec3 fragPosition;\n"
+                            "in vec3 vColor;\n"
                             "\n"
                             "out vec4 fragColor;\n"
                             "\n"
-                            "uniform vec3 objectColor;\n"
                             "uniform vec3 lightColor;\n"
                             "uniform vec3 lightDirection;\n"
                             "\n"
@@ -100,18 +218,125 @@ const char *fragment_code = "\n"
                             "    float diff = 0.6 * max(dot(n,-l) + 1.0, 0.0);\n"
                             "    vec3 diffuse = kd * diff * lightColor;\n"
                             "\n"
-                            "    vec3 light = diffuse * objectColor;\n"
+                            "    vec3 light = diffuse * vColor;\n"
                             "    fragColor = vec4(light, 1.0);\n"
                             "}\0";
 
+/** Vertex shader dos nós distantes. */
+const char *point_vertex_code = "\n"
+                                "#version 330 core\n"
+                                "layout (location = 0) in vec3 position;\n"
+                                "layout (location = 1) in vec3 color;\n"
+                                "\n"
+                                "uniform mat4 view;\n"
+                                "uniform mat4 projection;\n"
+                                "uniform float pointScale;\n"
+                                "\n"
+                                "out vec3 vColor;\n"
+                                "\n"
+                                "void main()\n"
+                                "{\n"
+                                "    gl_Position = projection * view * vec4(position, 1.0);\n"
+                                "    gl_PointSize = max(pointScale / gl_Position.w, 1.0);\n"
+                                "    vColor = color;\n"
+                                "}\0";
+
+/** Fragment shader dos nós distantes. */
+const char *point_fragment_code = "\n"
+                                  "#version 330 core\n"
+                                  "\n"
+                                  "in vec3 vColor;\n"
+                                  "\n"
+                                  "out vec4 fragColor;\n"
+                                  "\n"
+                                  "void main()\n"
+                                  "{\n"
+                                  "    vec2 d = gl_PointCoord * 2.0 - 1.0;\n"
+                                  "    if (dot(d, d) > 1.0)\n"
+                                  "        discard;\n"
+                                  "    fragColor = vec4(0.75 * vColor, 1.0);\n"
+                                  "}\0";
+
 /* Functions. */
 void display(void);
+void render(void);
 void reshape(int, int);
 void keyboard(unsigned char, int, int);
-void initData(void);
+void initData(const Mesh &);
 void initShaders(void);
-void runPrimStep();
-void initGraph();
+void setModelMatrix(const glm::mat4 &);
+void drawPerfHud();
+int runHeadless(int, char **);
+int runRenderBenchmark(int, char **);
+StartupTasks startLoading();
+bool finishLoading(StartupTasks &);
+int selectNodeLod(float);
+void setNodeInstanceAttributes(size_t);
+void reportFirstFrame();
+void reserveFrameData();
+void setAutoRun(AutoRun);
+
+/// Envia a matriz de modelo e a sua matriz de normais para o shader.
+///
+/// A matriz de normais é calculada uma vez por objeto aqui, em vez de uma vez por vértice no
+/// vertex shader.
+void setModelMatrix(const glm::mat4 &model) {
+    glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+    unsigned int loc = GL_COUNTED(glGetUniformLocation(program, "model"));
+    GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model)));
+
+    loc = GL_COUNTED(glGetUniformLocation(program, "normalMatrix"));
+    GL_COUNTED(glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(normal_matrix)));
+}
+
+/// Reserva os vetores que render() preenche a cada quadro com o tamanho que eles podem chegar a ter
+/// com o grafo atual, para que desenhar um quadro não aloque memória.
+void reserveFrameData() {
+    ALLOC_SCOPE(ALLOC_RENDERER);
+    far_points.reserve(6 * nodes.size());
+    for (int l = 0; l < (int)casa_lods.size(); l++) {
+        if (compact_vertices) {
+            compact_node_instances[l].reserve(nodes.size());
+        } else {
+            node_instances[l].reserve(nodes.size());
+        }
+    }
+}
+
+/// Escolhe o nível de detalhe mais simples da casinha cujo erro, a `distance` da câmera, fica
+/// abaixo de LOD_PIXEL_ERROR pixels na tela.
+int selectNodeLod(float distance) {
+    // Pixels na tela por unidade de comprimento, a essa distância.
+    float pixels_per_unit = win_height / (2.0f * tan(glm::radians(45.0f) / 2.0f)) / distance;
+    for (int l = casa_lods.size() - 1; l > 0; l--) {
+        if (casa_lods[l].error * NODE_SCALE * pixels_per_unit <= LOD_PIXEL_ERROR)
+            return l;
+    }
+    return 0;
+}
+
+/// Aponta os atributos de instância do VAO_CASA para o VBO_NOS, a partir da instância `first`.
+///
+/// O OpenGL 3.3 não tem glDrawElementsInstancedBaseInstance, então cada nível de detalhe
+/// desloca os ponteiros até as suas instâncias.
+void setNodeInstanceAttributes(size_t first) {
+    if (compact_vertices) {
+        size_t base = first * sizeof(CompactNodeInstance);
+        GL_COUNTED(glVertexAttribPointer(
+            2, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactNodeInstance),
+            (void *)(base + offsetof(CompactNodeInstance, position))));
+        GL_COUNTED(glVertexAttribPointer(3, 3, GL_UNSIGNED_BYTE, GL_TRUE,
+                                         sizeof(CompactNodeInstance),
+                                         (void *)(base + offsetof(CompactNodeInstance, color))));
+    } else {
+        size_t base = first * sizeof(NodeInstance);
+        GL_COUNTED(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(NodeInstance),
+                                         (void *)(base + offsetof(NodeInstance, position))));
+        GL_COUNTED(glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(NodeInstance),
+                                         (void *)(base + offsetof(NodeInstance, color))));
+    }
+}
 
 /**
  * Drawing function.
@@ -119,50 +344,92 @@ void initGraph();
  * Draws primitive.
  */
 void display() {
-    glClearColor(0.3, 0.6, 0.8, 1.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    TRACE_SCOPE("display");
+    ALLOC_SCOPE(ALLOC_RENDERER);
+    double start = perf_enabled ? perfNow() : 0.0;
+
+    render();
+    if (hud_visible) {
+        drawPerfHud();
+    }
+    if (!offscreen) {
+        glutSwapBuffers();
+    }
+    reportFirstFrame();
 
-    glUseProgram(program);
+    if (perf_enabled) {
+        frame_times.add(perfNow() - start);
+    }
+
+    if (gpu_timers.collected() - last_gpu_report >= 100) {
+        gpu_timers.print(stdout);
+        last_gpu_report = gpu_timers.collected();
+    }
+}
+
+/// Desenha a cena no framebuffer atual, seja o da janela ou um fora da tela.
+void render() {
+    TRACE_SCOPE("render");
+    ALLOC_SCOPE(ALLOC_RENDERER);
+    if (perf_enabled) {
+        frame_counters = FrameCounters();
+    }
+    // Lê os tempos de quadros anteriores, com chamadas contadas neste quadro.
+    gpu_timers.beginFrame();
+
+    GL_COUNTED(glClearColor(0.3, 0.6, 0.8, 1.0));
+    GL_COUNTED(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    GL_COUNTED(glUseProgram(program));
 
     unsigned int loc;
 
     glm::mat4 view =
         glm::lookAt(camera_pos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-    loc = glGetUniformLocation(program, "view");
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(view));
+    loc = GL_COUNTED(glGetUniformLocation(program, "view"));
+    GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(view)));
 
     glm::mat4 projection =
-        glm::perspective(glm::radians(45.0f), (win_width / (float)win_height), 0.1f, 100.0f);
-    loc = glGetUniformLocation(program, "projection");
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection));
+        glm::perspective(glm::radians(45.0f), (win_width / (float)win_height), 0.1f, far_plane);
+    loc = GL_COUNTED(glGetUniformLocation(program, "projection"));
+    GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection)));
 
     // Light color.
-    loc = glGetUniformLocation(program, "lightColor");
-    glUniform3f(loc, 1.0, 1.0, 1.0);
+    loc = GL_COUNTED(glGetUniformLocation(program, "lightColor"));
+    GL_COUNTED(glUniform3f(loc, 1.0, 1.0, 1.0));
 
     // Light position.
-    loc = glGetUniformLocation(program, "lightDirection");
-    glUniform3f(loc, -1.0, -3.0, -2.0);
+    loc = GL_COUNTED(glGetUniformLocation(program, "lightDirection"));
+    GL_COUNTED(glUniform3f(loc, -1.0, -3.0, -2.0));
+
+    glm::mat4 view_projection = projection * view;
+    Frustum frustum = Frustum::fromMatrix(view_projection);
 
     // draw edges
-    glBindVertexArray(VAO_CUBO);
-    for (int i = 0; i < nodes.size(); i++) {
-        auto node = nodes[i];
+    gpu_timers.begin(PASS_EDGES);
+    GL_COUNTED(glBindVertexArray(VAO_CUBO));
+    node_tree.query(frustum, true, [&](int i) {
+        const Node &node = nodes[i];
         if (!node.in_tree || node.connected_to == -1)
-            continue;
+            return;
+
+        auto start = node.position;
+        auto end = nodes[node.connected_to].position;
+
+        glm::vec3 pad(EDGE_RADIUS, EDGE_HEIGHT, EDGE_RADIUS);
+        if (frustum.classify(glm::min(start, end) - pad, glm::max(start, end) + pad) ==
+            Containment::Outside)
+            return;
 
         // Object color.
-        loc = glGetUniformLocation(program, "objectColor");
+        unsigned int loc = GL_COUNTED(glGetUniformLocation(program, "objectColor"));
         if (i == last_added) {
-            glUniform3f(loc, 0.1, 0.1, 0.85);
+            GL_COUNTED(glUniform3f(loc, 0.1, 0.1, 0.85));
         } else {
-            glUniform3f(loc, 0.85, 0.7, 0.5);
+            GL_COUNTED(glUniform3f(loc, 0.85, 0.7, 0.5));
         }
 
-        auto start = node.position;
-        auto end = nodes[node.connected_to].position;
-
         float dist = glm::distance(start, end);
 
         auto dir = end - start;
@@ -171,50 +438,178 @@ void display() {
         auto model = glm::mat4(1.0f);
         model = glm::translate(model, (start + end) / 2.0f);
         model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.3f, 0.05f, dist));
-
-        loc = glGetUniformLocation(program, "model");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model));
+        model = glm::scale(model, glm::vec3(2.0f * EDGE_RADIUS, 2.0f * EDGE_HEIGHT, dist));
+        setModelMatrix(model);
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
+        GL_COUNTED(glDrawArrays(GL_TRIANGLES, 0, 36));
+        countDrawCall();
+    });
+    gpu_timers.end(PASS_EDGES);
 
     // draw ground
+    gpu_timers.begin(PASS_GROUND);
     {
-        loc = glGetUniformLocation(program, "objectColor");
-        glUniform3f(loc, 0.3, 0.8, 0.0);
+        loc = GL_COUNTED(glGetUniformLocation(program, "objectColor"));
+        GL_COUNTED(glUniform3f(loc, 0.3, 0.8, 0.0));
 
         auto model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0, -0.5, 0.0));
         model = glm::scale(model, glm::vec3(12.0, 1.0, 12.0));
+        setModelMatrix(model);
 
-        loc = glGetUniformLocation(program, "model");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model));
-
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        GL_COUNTED(glDrawArrays(GL_TRIANGLES, 0, 36));
+        countDrawCall();
     }
 
+    gpu_timers.end(PASS_GROUND);
+
     // draw nodes
-    glBindVertexArray(VAO_CASA);
-    for (auto node : nodes) {
-        loc = glGetUniformLocation(program, "objectColor");
-        if (node.in_tree) {
-            glUniform3f(loc, 1.0, 0.2, 0.2);
+    gpu_timers.begin(PASS_NODES);
+    far_points.clear();
+    for (int l = 0; l < MAX_MESH_LODS; l++) {
+        node_instances[l].clear();
+        compact_node_instances[l].clear();
+    }
+    node_tree.query(frustum, false, [&](int i) {
+        const Node &node = nodes[i];
+        glm::vec3 color = node.in_tree ? glm::vec3(1.0, 0.2, 0.2) : glm::vec3(0.7, 0.14, 0.14);
+
+        // Casinhas distantes ocupam poucos pixels: desenha um ponto no lugar.
+        float distance = glm::distance(camera_pos, node.position);
+        if (distance > LOD_DISTANCE) {
+            float point[6] = {node.position.x, node.position.y + NODE_HEIGHT / 2.0f,
+                              node.position.z, color.x,          color.y,
+                              color.z};
+            far_points.insert(far_points.end(), point, point + 6);
+            return;
+        }
+
+        int level = selectNodeLod(distance);
+        if (compact_vertices) {
+            glm::vec3 p = (node.position - node_origin) / node_extent;
+            compact_node_instances[level].push_back(CompactNodeInstance{
+                .position = {(uint16_t)glm::packUnorm1x16(p.x), (uint16_t)glm::packUnorm1x16(p.y),
+                             (uint16_t)glm::packUnorm1x16(p.z), 0},
+                .color = {(uint8_t)(color.x * 255.0f + 0.5f), (uint8_t)(color.y * 255.0f + 0.5f),
+                          (uint8_t)(color.z * 255.0f + 0.5f), 255},
+            });
         } else {
-            glUniform3f(loc, 0.7, 0.14, 0.14);
+            node_instances[level].push_back(
+                NodeInstance{.position = node.position, .color = color});
         }
+    });
+
+    // draw near nodes, one call per level of detail
+    size_t instance_size = compact_vertices ? sizeof(CompactNodeInstance) : sizeof(NodeInstance);
+    size_t instance_count[MAX_MESH_LODS];
+    size_t total_instances = 0;
+    for (int l = 0; l < MAX_MESH_LODS; l++) {
+        instance_count[l] = compact_vertices ? compact_node_instances[l].size()
+                                             : node_instances[l].size();
+        total_instances += instance_count[l];
+    }
+    if (total_instances > 0) {
+        GL_COUNTED(glUseProgram(node_program));
+
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "view"));
+        GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(view)));
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "projection"));
+        GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection)));
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "lightColor"));
+        GL_COUNTED(glUniform3f(loc, 1.0, 1.0, 1.0));
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "lightDirection"));
+        GL_COUNTED(glUniform3f(loc, -1.0, -3.0, -2.0));
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "nodeScale"));
+        GL_COUNTED(glUniform1f(loc, NODE_SCALE));
+
+        // As posições compactas são relativas à caixa dos nós; as em float já são absolutas.
+        glm::vec3 origin = compact_vertices ? node_origin : glm::vec3(0.0f);
+        glm::vec3 extent = compact_vertices ? node_extent : glm::vec3(1.0f);
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "instanceOrigin"));
+        GL_COUNTED(glUniform3f(loc, origin.x, origin.y, origin.z));
+        loc = GL_COUNTED(glGetUniformLocation(node_program, "instanceExtent"));
+        GL_COUNTED(glUniform3f(loc, extent.x, extent.y, extent.z));
+
+        // As instâncias de todos os níveis vão num buffer só, um nível depois do outro.
+        GL_COUNTED(glBindVertexArray(VAO_CASA));
+        GL_COUNTED(glBindBuffer(GL_ARRAY_BUFFER, VBO_NOS));
+        GL_COUNTED(glBufferData(GL_ARRAY_BUFFER, total_instances * instance_size, NULL,
+                                GL_STREAM_DRAW));
+        countUpload(total_instances * instance_size);
+
+        size_t first = 0;
+        for (int l = 0; l < (int)casa_lods.size(); l++) {
+            if (instance_count[l] == 0)
+                continue;
+            const void *data = compact_vertices ? (const void *)compact_node_instances[l].data()
+                                                : (const void *)node_instances[l].data();
+            GL_COUNTED(glBufferSubData(GL_ARRAY_BUFFER, first * instance_size,
+                                       instance_count[l] * instance_size, data));
+            setNodeInstanceAttributes(first);
+
+            const MeshLod &lod = casa_lods[l];
+            GL_COUNTED(glDrawElementsInstanced(GL_TRIANGLES, lod.index_count, casa_index_type,
+                                               (void *)(lod.index_offset * casa_index_size),
+                                               instance_count[l]));
+            countDrawCall();
+            first += instance_count[l];
+        }
+    }
 
-        auto model = glm::mat4(1.0f);
-        model = glm::translate(model, node.position);
-        model = glm::scale(model, glm::vec3(0.5));
+    // draw distant nodes
+    if (!far_points.empty()) {
+        GL_COUNTED(glUseProgram(point_program));
+
+        loc = GL_COUNTED(glGetUniformLocation(point_program, "view"));
+        GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(view)));
+        loc = GL_COUNTED(glGetUniformLocation(point_program, "projection"));
+        GL_COUNTED(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection)));
+
+        // Tamanho em pixels de um objeto de largura 2 * NODE_RADIUS a uma unidade da câmera.
+        loc = GL_COUNTED(glGetUniformLocation(point_program, "pointScale"));
+        float point_scale =
+            2.0f * NODE_RADIUS * win_height / (2.0f * tan(glm::radians(45.0f) / 2.0f));
+        GL_COUNTED(glUniform1f(loc, point_scale));
+
+        GL_COUNTED(glBindVertexArray(VAO_PONTOS));
+        GL_COUNTED(glBindBuffer(GL_ARRAY_BUFFER, VBO_PONTOS));
+        GL_COUNTED(glBufferData(GL_ARRAY_BUFFER, sizeof(float) * far_points.size(),
+                                far_points.data(), GL_STREAM_DRAW));
+        countUpload(sizeof(float) * far_points.size());
+        GL_COUNTED(glDrawArrays(GL_POINTS, 0, far_points.size() / 6));
+        countDrawCall();
+    }
+    gpu_timers.end(PASS_NODES);
 
-        unsigned int loc = glGetUniformLocation(program, "model");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model));
+    GL_COUNTED(glBindVertexArray(0));
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
+    gpu_timers.endFrame();
+}
 
-    glutSwapBuffers();
+/// Desenha o HUD com as métricas de desempenho coletadas.
+void drawPerfHud() {
+    static const char *auto_run_names[] = {"off", "budget", "complete"};
+    // Os contadores do quadro atual, antes de somar as chamadas do próprio HUD.
+    FrameCounters counters = frame_counters;
+
+    int in_tree = nodes.size() - not_included.size();
+    int edges = in_tree > 0 ? in_tree - 1 : 0;
+    size_t graph_bytes = graphArena().capacity() + node_tree.memoryUsage();
+    SampleStats frame = frame_times.stats();
+    SampleStats step = step_times.stats();
+
+    snprintf(hud_text, sizeof(hud_text),
+             "frame   %7.3f ms avg  %7.3f ms p99\n"
+             "prim    %7.3f ms avg  %7.3f ms p99\n"
+             "auto    %s  %d steps/frame\n"
+             "draw calls %d  gl calls %d\n"
+             "nodes %d  edges %d\n"
+             "graph memory %.1f kb",
+             frame.mean, frame.p99, step.mean, step.p99, auto_run_names[auto_run], auto_run_steps,
+             counters.draw_calls, counters.gl_calls, (int)nodes.size(), edges,
+             graph_bytes / 1024.0);
+
+    drawHud(hud_text, win_width, win_height);
 }
 
 /**
@@ -267,75 +662,36 @@ void keyboard(unsigned char key, int x, int y) {
     case 'n':
         runPrimStep();
         break;
+    case 'g':
+        setAutoRun(auto_run == AUTO_RUN_BUDGET ? AUTO_RUN_OFF : AUTO_RUN_BUDGET);
+        break;
+    case 'f':
+        setAutoRun(auto_run == AUTO_RUN_COMPLETE ? AUTO_RUN_OFF : AUTO_RUN_COMPLETE);
+        break;
     case 'r':
         initGraph();
+        reserveFrameData();
+        break;
+    case 't':
+        traceFlush();
+        break;
+    case 'h':
+        hud_visible = !hud_visible;
+        perf_enabled = hud_visible;
+        frame_times.clear();
+        step_times.clear();
         break;
     }
 }
 
-std::vector<float> loadModel() {
-    std::string inputfile = "vertice.obj";
-    tinyobj::ObjReaderConfig reader_config;
-    reader_config.mtl_search_path = "./"; // Path to material files
-
-    tinyobj::ObjReader reader;
-
-    if (!reader.ParseFromFile(inputfile, reader_config)) {
-        if (!reader.Error().empty()) {
-            std::cerr << "TinyObjReader: " << reader.Error();
-        }
-        exit(1);
-    }
-
-    if (!reader.Warning().empty()) {
-        std::cout << "TinyObjReader: " << reader.Warning();
-    }
-
-    auto &attrib = reader.GetAttrib();
-    auto &shapes = reader.GetShapes();
-    auto &materials = reader.GetMaterials();
-
-    std::vector<float> vertices;
-
-    // Loop over shapes
-    for (size_t s = 0; s < shapes.size(); s++) {
-        // Loop over faces(polygon)
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-            size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
-
-            // Loop over vertices in the face.
-            for (size_t v = 0; v < fv; v++) {
-                // access to vertex
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-                tinyobj::real_t vx = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-                tinyobj::real_t vy = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-                tinyobj::real_t vz = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
-
-                tinyobj::real_t nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
-                tinyobj::real_t ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
-                tinyobj::real_t nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
-
-                vertices.push_back(vx);
-                vertices.push_back(vy);
-                vertices.push_back(vz);
-                vertices.push_back(nx);
-                vertices.push_back(ny);
-                vertices.push_back(nz);
-            }
-            index_offset += fv;
-        }
-    }
-
-    return vertices;
-}
-
 /**
  * Init vertex data.
  *
  * Defines the coordinates for vertices, creates the arrays for OpenGL.
  */
-void initData() {
+void initData(const Mesh &casinha) {
+    TRACE_SCOPE("initData");
+    ALLOC_SCOPE(ALLOC_RENDERER);
     // Set cube vertices.
     float cubo[] = {
         // coordinate        // normal
@@ -377,15 +733,13 @@ void initData() {
         0.5f,  -0.5f, 0.5f,  0.0f,  -1.0f, 0.0f,
     };
 
-    std::vector<float> casinha = loadModel();
-
     // Vertex array.
     glGenVertexArrays(1, &VAO_CUBO);
     glBindVertexArray(VAO_CUBO);
 
     // Vertex buffer
-    glGenBuffers(1, &VBO_CASA);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_CASA);
+    glGenBuffers(1, &VBO_CUBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_CUBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cubo), cubo, GL_STATIC_DRAW);
 
     // Set attributes.
@@ -401,9 +755,48 @@ void initData() {
     // Vertex buffer
     glGenBuffers(1, &VBO_CASA);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_CASA);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * casinha.size(), casinha.data(), GL_STATIC_DRAW);
+    if (compact_vertices) {
+        std::vector<unsigned char> packed = packCompactVertices(casinha);
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, COMPACT_VERTEX_SIZE, (void *)0);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, COMPACT_VERTEX_SIZE,
+                              (void *)8);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, casinha.vertexBytes(), casinha.vertices(), GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                              (void *)(3 * sizeof(float)));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    // Instance buffer, filled every frame.
+    glGenBuffers(1, &VBO_NOS);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_NOS);
+
+    setNodeInstanceAttributes(0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    // Index buffer, part of the vertex array state.
+    glGenBuffers(1, &EBO_CASA);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_CASA);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, casinha.indexBytes(), casinha.indices(), GL_STATIC_DRAW);
+    casa_lods = casinha.lods();
+    casa_index_size = casinha.indexSize();
+    casa_index_type = casa_index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    // Vertex array for the distant nodes, filled every frame.
+    glGenVertexArrays(1, &VAO_PONTOS);
+    glBindVertexArray(VAO_PONTOS);
+
+    glGenBuffers(1, &VBO_PONTOS);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_PONTOS);
 
-    // Set attributes.
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
@@ -413,6 +806,7 @@ void initData() {
     glBindVertexArray(0);
 
     glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PROGRAM_POINT_SIZE);
 }
 
 /** Create program (shaders).
@@ -420,65 +814,420 @@ void initData() {
  * Compile shaders and create the program.
  */
 void initShaders() {
+    ALLOC_SCOPE(ALLOC_RENDERER);
+    if (shader_dir)
+        initShaderReload(shader_dir);
+
     // Request a program and shader slots from GPU
-    program = createShaderProgram(vertex_code, fragment_code);
+    loadShaderProgram(&program, "scene.vert", vertex_code, "scene.frag", fragment_code);
+    loadShaderProgram(&point_program, "points.vert", point_vertex_code, "points.frag",
+                      point_fragment_code);
+    loadShaderProgram(&node_program, "nodes.vert", node_vertex_code, "scene.frag", fragment_code);
 }
 
-/// Reseta o gráfo para o estado inicial.
-void initGraph() {
-    nodes = std::vector<Node>();
-    for (int i = 0; i < 25; i++) {
-        int x = i / 5;
-        int y = i % 5;
-        float dx = 1.0 * ((float)rand() / (float)(RAND_MAX)-1.0);
-        float dy = 1.0 * ((float)rand() / (float)(RAND_MAX)-1.0);
+/// Recompila os shaders que mudaram, sem bloquear o desenho, e redesenha quando um programa é
+/// trocado.
+void pollShaders(int) {
+    if (updateShaderReload())
+        glutPostRedisplay();
+    glutTimerFunc(100, pollShaders, 0);
+}
 
-        auto position = glm::vec3((float)x * 2.0f - 4.0f + dx, 0.0f, -4.0f + 2.0f * (float)y + dy);
-        nodes.push_back(
-            Node{.position = position, .in_tree = false, .connected_to = -1, .cost = 1.0f / 0.0f});
-    }
-    not_included.clear();
-    for (int v = 0; v < nodes.size(); v++) {
-        not_included.push_back(v);
+/// Roda os passos do prim do modo automático entre os quadros, e o desliga quando a árvore fica
+/// completa.
+///
+/// Como só um quadro é pedido por vez, o tempo de cada quadro fica limitado ao orçamento do modo
+/// mais o tempo de desenhar, e a janela continua respondendo enquanto a árvore é construída.
+void autoRunIdle() {
+    double budget_ms = auto_run == AUTO_RUN_COMPLETE ? COMPLETE_BUDGET_MS : step_budget_ms;
+    auto_run_steps = runPrimSteps(budget_ms);
+    if (not_included.empty()) {
+        setAutoRun(AUTO_RUN_OFF);
     }
-    for (int i = 0; i < nodes.size() - 1; i++) {
-        int r = i + (rand() % (not_included.size() - i));
-        std::swap(not_included[i], not_included[r]);
+    glutPostRedisplay();
+}
+
+/// Troca o modo automático, ligando ou desligando a função idle do GLUT.
+void setAutoRun(AutoRun mode) {
+    auto_run = mode;
+    glutIdleFunc(mode == AUTO_RUN_OFF ? NULL : autoRunIdle);
+}
+
+/// Começa a ler o modelo e a gerar o grafo em outros threads.
+///
+/// Nada aqui usa o OpenGL, então pode rodar enquanto a janela e o contexto são criados; só o envio
+/// dos dados para a GPU, em initData, fica no thread principal.
+StartupTasks startLoading() {
+    StartupTasks tasks;
+    tasks.casinha = std::async(std::launch::async, [] {
+        traceThreadName("load model");
+        ALLOC_SCOPE(ALLOC_LOADER);
+        // O modelo embutido no executável dispensa ler o OBJ.
+        Mesh mesh;
+        if (!openEmbeddedMesh("vertice.obj", mesh)) {
+            mesh = loadModel("vertice.obj");
+        }
+        return mesh;
+    });
+    tasks.graph = std::async(std::launch::async, [] {
+        traceThreadName("init graph");
+        initGraph();
+        runPrimStep();
+    });
+    return tasks;
+}
+
+/// Espera as tarefas de startLoading e envia o modelo para a GPU, no thread principal.
+///
+/// Retorna false se o modelo não pôde ser lido; o motivo já foi mostrado por loadModel.
+bool finishLoading(StartupTasks &tasks) {
+    tasks.graph.get();
+    Mesh casinha = tasks.casinha.get();
+    if (casinha.indexCount() == 0) {
+        fprintf(stderr, "Could not load vertice.obj\n");
+        return false;
     }
+    initData(casinha);
+    return true;
+}
+
+/// Mostra quanto tempo levou até o primeiro quadro, na primeira vez que é chamada.
+void reportFirstFrame() {
+    if (startup_start < 0.0)
+        return;
+    double now = perfNow();
+    TRACE_EVENT("startup", startup_start, now);
+    printf("First frame after %.1f ms\n", now - startup_start);
+    startup_start = -1.0;
 }
 
-/// Roda uma iteração do algoritmo Prim.
+/// Roda a visualização sem janela, renderizando num framebuffer fora da tela.
+///
+/// Executa um passo do prim por quadro e reporta o tempo de CPU e o tempo de GPU de cada passe
+/// em cada quadro.
 ///
-/// beseado em: https://en.wikipedia.org/wiki/Prim%27s_algorithm#Description
-void runPrimStep() {
-    if (!not_included.empty()) {
-        float min_cost = 1.0f / 0.0f;
-        int min = -1;
-        for (int i = 0; i < not_included.size(); i++) {
-            int v = not_included[i];
-            if (min == -1 || nodes[v].cost < min_cost) {
-                min_cost = nodes[v].cost;
-                min = i;
+/// Opções:
+/// - `--steps N`: número de passos do prim (padrão: até a árvore estar completa).
+/// - `--size LxA`: tamanho do quadro em pixels.
+/// - `--capture DIR`: salva cada quadro como `DIR/frame_NNNNN.ppm`.
+/// - `--hud`: desenha o HUD de desempenho nos quadros.
+int runHeadless(int argc, char **argv) {
+    int steps = -1;
+    const char *capture_dir = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%dx%d", &win_width, &win_height);
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_dir = argv[++i];
+        } else if (strcmp(argv[i], "--hud") == 0) {
+            hud_visible = true;
+            perf_enabled = true;
+        }
+    }
+
+    StartupTasks tasks = startLoading();
+    if (!initHeadlessContext()) {
+        return 1;
+    }
+
+    initShaders();
+    initHud();
+    if (!finishLoading(tasks)) {
+        return 1;
+    }
+    reserveFrameData();
+
+    if (steps < 0) {
+        steps = not_included.size();
+    }
+
+    OffscreenTarget target = createOffscreenTarget(win_width, win_height);
+    FrameCapture capture;
+    if (capture_dir) {
+        capture.init(win_width, win_height, capture_dir);
+    }
+
+    int frames = steps + 1;
+    gpu_timers.init();
+    gpu_timers.keepHistory(true, frames);
+    std::vector<double> step_ms(frames, 0.0);
+    std::vector<double> cpu_ms(frames, 0.0);
+    // Alocações feitas por cada passo e por cada quadro, que deveriam ser zero depois do primeiro.
+    std::vector<uint64_t> step_allocs(frames, 0);
+    std::vector<uint64_t> frame_allocs(frames, 0);
+
+    using Clock = std::chrono::steady_clock;
+    for (int frame = 0; frame < frames; frame++) {
+        if (frame > 0) {
+            uint64_t allocs = threadAllocations();
+            auto start = Clock::now();
+            runPrimStep();
+            step_ms[frame] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            step_allocs[frame] = threadAllocations() - allocs;
+        }
+
+        uint64_t allocs = threadAllocations();
+        auto start = Clock::now();
+        render();
+        if (hud_visible) {
+            drawPerfHud();
+        }
+        cpu_ms[frame] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        frame_allocs[frame] = threadAllocations() - allocs;
+        reportFirstFrame();
+        if (perf_enabled) {
+            frame_times.add(cpu_ms[frame]);
+        }
+
+        if (capture_dir) {
+            capture.capture(frame);
+        }
+    }
+
+    if (capture_dir) {
+        capture.finish();
+    }
+
+    gpu_timers.flush();
+
+    printf("%6s %10s %10s %10s %10s %10s\n", "frame", "step_ms", "cpu_ms", "gpu_edges",
+           "gpu_ground", "gpu_nodes");
+    double total_step = 0.0, total_cpu = 0.0;
+    for (int frame = 0; frame < frames; frame++) {
+        printf("%6d %10.4f %10.4f", frame, step_ms[frame], cpu_ms[frame]);
+        for (int pass = 0; pass < PASS_COUNT; pass++) {
+            // Resultados descartados por não estarem prontos a tempo.
+            if (gpu_timers.history[pass][frame] < 0) {
+                printf(" %10s", "-");
+            } else {
+                printf(" %10.4f", gpu_timers.history[pass][frame]);
             }
         }
-        int v = not_included[min];
-        not_included.erase(not_included.begin() + min);
-        nodes[v].in_tree = true;
-        last_added = v;
-
-        for (int w : not_included) {
-            float new_cost = glm::distance(nodes[v].position, nodes[w].position);
-            if (new_cost < nodes[w].cost) {
-                nodes[w].connected_to = v;
-                nodes[w].cost = new_cost;
+        printf("\n");
+        total_step += step_ms[frame];
+        total_cpu += cpu_ms[frame];
+    }
+    printf("%6s %10.4f %10.4f\n", "mean", total_step / frames, total_cpu / frames);
+    gpu_timers.print(stdout);
+
+    // O primeiro quadro ainda pode alocar, ao dar aos buffers o tamanho de que precisam.
+    int failures = 0;
+    if (alloc_stats_enabled) {
+        for (int frame = 1; frame < frames; frame++) {
+            if (step_allocs[frame] == 0 && frame_allocs[frame] == 0)
+                continue;
+            fprintf(stderr, "frame %d: %llu allocations in the step, %llu in the frame\n", frame,
+                    (unsigned long long)step_allocs[frame],
+                    (unsigned long long)frame_allocs[frame]);
+            failures++;
+        }
+        printf("%d of %d frames allocated memory after the first\n", failures, frames - 1);
+    }
+
+    gpu_timers.destroy();
+    destroyOffscreenTarget(target);
+    destroyHeadlessContext();
+    return failures > 0 ? 1 : 0;
+}
+
+/// Lê uma lista de números separados por vírgula, como `25,1000,10000`.
+std::vector<double> parseNumberList(const char *text) {
+    std::vector<double> values;
+    char *end;
+    for (double value = strtod(text, &end); end != text; value = strtod(text, &end)) {
+        values.push_back(value);
+        text = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+/// Resultado de uma cena do benchmark de renderização.
+struct RenderResult {
+    int nodes;
+    double complete;
+    /// Tempo de cada quadro até a GPU terminar, e tempo de CPU dentro de display().
+    SampleStats frame;
+    SampleStats cpu;
+    /// Médias por quadro.
+    double draw_calls;
+    double uploaded_bytes;
+};
+
+/// Mede a renderização de cenas de vários tamanhos, com partes diferentes da árvore completas,
+/// num framebuffer fora da tela.
+///
+/// Em cada cena a câmera dá uma volta em torno do grafo, se aproximando e se afastando, sempre no
+/// mesmo caminho, e cada quadro é desenhado com display(), como na janela. São reportados o tempo
+/// de cada quadro até a GPU terminar, o tempo de CPU dentro de display(), e as chamadas de desenho
+/// e os bytes enviados por quadro.
+///
+/// Opções:
+/// - `--nodes N,N...`: número de nós de cada cena (padrão: 25,1000,10000).
+/// - `--complete F,F...`: fração dos nós já na árvore (padrão: 0,0.5,1).
+/// - `--frames N`: quadros medidos em cada cena (padrão: 240).
+/// - `--size LxA`: tamanho do quadro em pixels.
+/// - `--out ARQUIVO`: salva os resultados em JSON.
+int runRenderBenchmark(int argc, char **argv) {
+    std::vector<double> node_counts = {25, 1000, 10000};
+    std::vector<double> completions = {0.0, 0.5, 1.0};
+    int frames = 240;
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            node_counts = parseNumberList(argv[++i]);
+        } else if (strcmp(argv[i], "--complete") == 0 && i + 1 < argc) {
+            completions = parseNumberList(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%dx%d", &win_width, &win_height);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        }
+    }
+
+    StartupTasks tasks = startLoading();
+    if (!initHeadlessContext()) {
+        return 1;
+    }
+    offscreen = true;
+    perf_enabled = true;
+
+    initShaders();
+    if (!finishLoading(tasks)) {
+        return 1;
+    }
+    OffscreenTarget target = createOffscreenTarget(win_width, win_height);
+
+    // Quadros desenhados antes de medir, para aquecer os caches e o driver.
+    const int WARMUP_FRAMES = 10;
+
+    std::vector<RenderResult> results;
+    for (double node_count : node_counts) {
+        for (double complete : completions) {
+            RenderResult result = {};
+            result.nodes = (int)node_count;
+            result.complete = complete;
+
+            // A mesma cena em todas as execuções.
+            srand(1);
+            initGraph(result.nodes);
+            reserveFrameData();
+            int in_tree = (int)(complete * result.nodes + 0.5);
+            while ((int)(nodes.size() - not_included.size()) < in_tree) {
+                runPrimStep();
+            }
+
+            // O caminho da câmera cresce com o grafo, que ocupa um quadrado de lado ~2 sqrt(N).
+            float radius = 10.0f + sqrtf((float)result.nodes);
+            float scene_radius = 0.0f;
+            for (const Node &node : nodes)
+                scene_radius = std::max(scene_radius, glm::length(node.position));
+            std::vector<double> frame_ms, cpu_ms;
+            for (int frame = -WARMUP_FRAMES; frame < frames; frame++) {
+                float t = (float)std::max(frame, 0) / frames;
+                float angle = glm::radians(360.0f) * t;
+                float distance = radius * (1.0f - 0.5f * sinf(glm::radians(180.0f) * t));
+                camera_pos = glm::vec3(distance * sinf(angle), 5.0f + 0.5f * distance,
+                                       distance * cosf(angle));
+                // Todo o grafo fica antes do plano distante, para não medir quadros recortados.
+                far_plane = std::max(100.0f, glm::length(camera_pos) + scene_radius + 1.0f);
+
+                double start = perfNow();
+                double cpu_start = perfThreadCpuNow();
+                display();
+                double cpu = perfThreadCpuNow() - cpu_start;
+                glFinish();
+                double elapsed = perfNow() - start;
+
+                if (frame >= 0) {
+                    frame_ms.push_back(elapsed);
+                    cpu_ms.push_back(cpu);
+                    result.draw_calls += frame_counters.draw_calls;
+                    result.uploaded_bytes += frame_counters.uploaded_bytes;
+                }
             }
+            result.frame = sampleStats(frame_ms);
+            result.cpu = sampleStats(cpu_ms);
+            result.draw_calls /= frames;
+            result.uploaded_bytes /= frames;
+            results.push_back(result);
         }
-    } else {
-        last_added = -1;
     }
+
+    printf("%8s %8s %10s %10s %10s %10s %10s %8s %12s\n", "nodes", "complete", "frame_ms",
+           "frame_p50", "frame_p99", "cpu_ms", "cpu_p99", "draws", "upload_kb");
+    for (const RenderResult &r : results) {
+        printf("%8d %8.2f %10.4f %10.4f %10.4f %10.4f %10.4f %8.1f %12.2f\n", r.nodes, r.complete,
+               r.frame.mean, r.frame.p50, r.frame.p99, r.cpu.mean, r.cpu.p99, r.draw_calls,
+               r.uploaded_bytes / 1024.0);
+    }
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        fprintf(out, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n", win_width,
+                win_height, frames);
+        fprintf(out, "  \"renderer\": \"%s\",\n", glGetString(GL_RENDERER));
+        fprintf(out, "  \"scenes\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const RenderResult &r = results[i];
+            fprintf(out, "    {\"nodes\": %d, \"complete\": %g, ", r.nodes, r.complete);
+            fprintf(out, "\"frame_mean_ms\": %.6f, \"frame_p50_ms\": %.6f, ", r.frame.mean,
+                    r.frame.p50);
+            fprintf(out, "\"frame_p99_ms\": %.6f, \"cpu_mean_ms\": %.6f, ", r.frame.p99,
+                    r.cpu.mean);
+            fprintf(out, "\"cpu_p50_ms\": %.6f, \"cpu_p99_ms\": %.6f, ", r.cpu.p50, r.cpu.p99);
+            fprintf(out, "\"draw_calls\": %.2f, \"uploaded_bytes\": %.1f}%s\n", r.draw_calls,
+                    r.uploaded_bytes, i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        fclose(out);
+    }
+
+    destroyOffscreenTarget(target);
+    destroyHeadlessContext();
+    return 0;
 }
 
 int main(int argc, char **argv) {
+    bool headless = false;
+    bool bench_render = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--bench-render") == 0) {
+            bench_render = true;
+        } else if (strcmp(argv[i], "--float-vertices") == 0) {
+            compact_vertices = false;
+        } else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+            shader_dir = argv[++i];
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            graphArena().setHugePages(true);
+        } else if (strcmp(argv[i], "--step-budget") == 0 && i + 1 < argc) {
+            step_budget_ms = atof(argv[++i]);
+        }
+    }
+    startup_start = perfNow();
+    traceThreadName("main");
+    if (alloc_stats_enabled) {
+        atexit(printAllocReport);
+    }
+    if (bench_render) {
+        return runRenderBenchmark(argc, argv);
+    }
+    if (headless) {
+        return runHeadless(argc, argv);
+    }
+
+    // Init the nodes of the graph and load the models while the window is created.
+    StartupTasks tasks = startLoading();
+
     glutInit(&argc, argv);
     glutInitContextVersion(3, 3);
     glutInitContextProfile(GLUT_CORE_PROFILE);
@@ -487,19 +1236,23 @@ int main(int argc, char **argv) {
     glutCreateWindow(argv[0]);
     glewInit();
 
-    // Init the nodes of the graph
-    initGraph();
-    runPrimStep();
-
-    // Init vertex data for the triangle.
-    initData();
-
     // Create shaders.
     initShaders();
 
+    // Init vertex data, once the models are loaded.
+    if (!finishLoading(tasks)) {
+        return 1;
+    }
+    reserveFrameData();
+
+    gpu_timers.init();
+    initHud();
+
     glutReshapeFunc(reshape);
     glutDisplayFunc(display);
     glutKeyboardFunc(keyboard);
+    if (shader_dir)
+        glutTimerFunc(100, pollShaders, 0);
 
     glutMainLoop();
 }
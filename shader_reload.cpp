@@ -0,0 +1,280 @@
+/**
+ * @file shader_reload.cpp
+ * Shaders lidos de arquivos e recompilados quando eles mudam.
+ */
+
+#include "shader_reload.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/// Um programa criado a partir de arquivos.
+struct WatchedProgram {
+    int *program;
+    std::string vertex_file;
+    std::string fragment_file;
+    /// Data de modificação dos arquivos, quando não há inotify.
+    int64_t vertex_mtime;
+    int64_t fragment_mtime;
+
+    /// Se os arquivos mudaram desde a última compilação.
+    bool dirty = false;
+    /// O programa sendo compilado e os seus shaders, ou 0.
+    int pending = 0;
+    int vertex = 0;
+    int fragment = 0;
+};
+
+/// Diretório dos shaders; vazio se os shaders são os embutidos.
+static std::string shader_dir;
+static std::vector<WatchedProgram> watched;
+/// Se o diretório já está sendo observado.
+static bool watching = false;
+/// Descritor do inotify, ou -1 se as datas dos arquivos são verificadas.
+static int inotify_fd = -1;
+/// Se o driver compila em segundo plano (GL_KHR_parallel_shader_compile).
+static bool parallel_compile = false;
+
+/// Lê o arquivo `path` inteiro.
+///
+/// @return false se o arquivo não pôde ser lido.
+static bool readFile(const std::string &path, std::string &text) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    text.clear();
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, n);
+    fclose(file);
+    return true;
+}
+
+static int64_t modificationTime(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return 0;
+    return st.st_mtime;
+}
+
+/// Lê o shader `file` do diretório de shaders, criando-o com `code` se ele não existir.
+static std::string loadShaderFile(const char *file, const char *code) {
+    std::string path = shader_dir + "/" + file;
+    std::string text;
+    if (readFile(path, text))
+        return text;
+
+    FILE *out = fopen(path.c_str(), "wb");
+    if (out) {
+        fwrite(code, 1, strlen(code), out);
+        fclose(out);
+    } else {
+        fprintf(stderr, "Could not write shader %s\n", path.c_str());
+    }
+    return code;
+}
+
+void initShaderReload(const char *dir) {
+    shader_dir = dir;
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+
+    if (GLEW_KHR_parallel_shader_compile) {
+        parallel_compile = true;
+        // Deixa o driver usar quantos threads quiser.
+        glMaxShaderCompilerThreadsKHR(0xffffffff);
+    }
+}
+
+void loadShaderProgram(int *program, const char *vertex_file, const char *vertex_code,
+                       const char *fragment_file, const char *fragment_code) {
+    if (shader_dir.empty()) {
+        *program = createShaderProgram(vertex_code, fragment_code);
+        return;
+    }
+
+    std::string vertex_source = loadShaderFile(vertex_file, vertex_code);
+    std::string fragment_source = loadShaderFile(fragment_file, fragment_code);
+    *program = createShaderProgram(vertex_source.c_str(), fragment_source.c_str());
+
+    WatchedProgram w;
+    w.program = program;
+    w.vertex_file = vertex_file;
+    w.fragment_file = fragment_file;
+    w.vertex_mtime = modificationTime(shader_dir + "/" + vertex_file);
+    w.fragment_mtime = modificationTime(shader_dir + "/" + fragment_file);
+    watched.push_back(w);
+}
+
+/// Marca os programas cujos arquivos têm uma data de modificação diferente da registrada.
+static void checkModificationTimes() {
+    for (WatchedProgram &w : watched) {
+        int64_t vertex_mtime = modificationTime(shader_dir + "/" + w.vertex_file);
+        int64_t fragment_mtime = modificationTime(shader_dir + "/" + w.fragment_file);
+        if (vertex_mtime != w.vertex_mtime || fragment_mtime != w.fragment_mtime) {
+            w.vertex_mtime = vertex_mtime;
+            w.fragment_mtime = fragment_mtime;
+            w.dirty = true;
+        }
+    }
+}
+
+/// Começa a observar o diretório.
+///
+/// Só é chamado depois que os programas foram criados, para que os arquivos criados com o código
+/// embutido em loadShaderFile não gerem eventos e recompilem tudo na primeira verificação.
+static void startWatching() {
+    watching = true;
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Editores costumam salvar num arquivo novo e renomeá-lo, por isso o IN_MOVED_TO.
+    if (inotify_fd >= 0 &&
+        inotify_add_watch(inotify_fd, shader_dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+#endif
+}
+
+/// Marca os programas cujos arquivos mudaram.
+static void findChanges() {
+    if (!watching) {
+        startWatching();
+        // Os arquivos salvos antes de o diretório passar a ser observado.
+        checkModificationTimes();
+        return;
+    }
+
+#ifdef __linux__
+    if (inotify_fd >= 0) {
+        alignas(struct inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char *p = buffer; p < buffer + length;) {
+                struct inotify_event *event = (struct inotify_event *)p;
+                if (event->len > 0) {
+                    for (WatchedProgram &w : watched) {
+                        if (w.vertex_file == event->name || w.fragment_file == event->name)
+                            w.dirty = true;
+                    }
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return;
+    }
+#endif
+
+    checkModificationTimes();
+}
+
+/// Começa a compilar o programa `w` a partir dos arquivos, sem esperar pelo resultado.
+static void startCompile(WatchedProgram &w) {
+    w.dirty = false;
+
+    std::string vertex_source, fragment_source;
+    if (!readFile(shader_dir + "/" + w.vertex_file, vertex_source) ||
+        !readFile(shader_dir + "/" + w.fragment_file, fragment_source))
+        return;
+    const char *vertex_code = vertex_source.c_str();
+    const char *fragment_code = fragment_source.c_str();
+
+    w.vertex = glCreateShader(GL_VERTEX_SHADER);
+    w.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(w.vertex, 1, &vertex_code, NULL);
+    glShaderSource(w.fragment, 1, &fragment_code, NULL);
+    glCompileShader(w.vertex);
+    glCompileShader(w.fragment);
+
+    w.pending = glCreateProgram();
+    glAttachShader(w.pending, w.vertex);
+    glAttachShader(w.pending, w.fragment);
+    glLinkProgram(w.pending);
+}
+
+/// Mostra o log de compilação de `shader`, se houver erro.
+static void reportShaderErrors(int shader, const std::string &file) {
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success)
+        return;
+    char error[1024];
+    glGetShaderInfoLog(shader, sizeof(error), NULL, error);
+    fprintf(stderr, "%s: %s\n", file.c_str(), error);
+}
+
+/// Troca o programa de `w` pelo compilado, se a compilação terminou.
+///
+/// @return false se a compilação ainda está em andamento.
+static bool finishCompile(WatchedProgram &w) {
+    int done = 1;
+    if (parallel_compile)
+        glGetProgramiv(w.pending, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done)
+        return false;
+
+    int success;
+    glGetProgramiv(w.pending, GL_LINK_STATUS, &success);
+    if (success) {
+        glDeleteProgram(*w.program);
+        *w.program = w.pending;
+        printf("Reloaded %s + %s\n", w.vertex_file.c_str(), w.fragment_file.c_str());
+    } else {
+        // O programa antigo continua em uso.
+        reportShaderErrors(w.vertex, w.vertex_file);
+        reportShaderErrors(w.fragment, w.fragment_file);
+        char error[1024];
+        glGetProgramInfoLog(w.pending, sizeof(error), NULL, error);
+        fprintf(stderr, "Program link error: %s\n", error);
+    }
+
+    glDetachShader(w.pending, w.vertex);
+    glDetachShader(w.pending, w.fragment);
+    glDeleteShader(w.vertex);
+    glDeleteShader(w.fragment);
+    if (!success)
+        glDeleteProgram(w.pending);
+    w.pending = w.vertex = w.fragment = 0;
+    return true;
+}
+
+bool updateShaderReload() {
+    if (watched.empty())
+        return false;
+
+    findChanges();
+
+    bool busy = false;
+    for (WatchedProgram &w : watched) {
+        if (w.pending) {
+            if (!finishCompile(w)) {
+                busy = true;
+                continue;
+            }
+            busy = true;
+        }
+        // Um arquivo que mudou durante a compilação é compilado de novo quando ela termina.
+        if (w.dirty) {
+            startCompile(w);
+            busy = true;
+        }
+    }
+    return busy;
+}
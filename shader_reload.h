@@ -0,0 +1,34 @@
+/**
+ * @file shader_reload.h
+ * Shaders lidos de arquivos e recompilados quando eles mudam.
+ *
+ * Sem um diretório de shaders, os programas são criados com o código embutido no executável.
+ * Com um diretório, cada shader vem de um arquivo nele (criado com o código embutido, se não
+ * existir), e o diretório é observado: quando um arquivo muda, os programas que o usam são
+ * recompilados em segundo plano, com o GL_KHR_parallel_shader_compile quando disponível. O
+ * programa antigo continua em uso até o novo ser ligado com sucesso; se houver erro, ele é
+ * mostrado e o antigo fica.
+ *
+ * No Linux o diretório é observado com inotify; nos outros sistemas, pela data de modificação dos
+ * arquivos.
+ */
+
+#pragma once
+
+/// Passa a ler os shaders do diretório `dir`. Chamado antes de criar os programas; o diretório só
+/// passa a ser observado na primeira chamada de updateShaderReload, depois que os arquivos que
+/// faltavam foram criados.
+void initShaderReload(const char *dir);
+
+/// Cria `*program` a partir dos shaders `vertex_file` e `fragment_file`, ou do código embutido
+/// `vertex_code` e `fragment_code` se não há diretório de shaders.
+///
+/// Com um diretório, `*program` é trocado por updateShaderReload quando os arquivos mudam.
+void loadShaderProgram(int *program, const char *vertex_file, const char *vertex_code,
+                       const char *fragment_file, const char *fragment_code);
+
+/// Começa a recompilar os programas cujos arquivos mudaram, e troca os que terminaram. Não
+/// espera pelas compilações em andamento.
+///
+/// @return true se algum programa foi trocado ou ainda está compilando.
+bool updateShaderReload();
@@ -0,0 +1,116 @@
+/**
+ * @file spatial.cpp
+ * Estruturas espaciais usadas para descartar o que está fora da câmera.
+ */
+
+#include "spatial.h"
+
+#include <algorithm>
+
+/// Número máximo de pontos numa folha da quadtree.
+static const int LEAF_SIZE = 8;
+/// Profundidade máxima da quadtree, para o caso de muitos pontos coincidentes.
+static const int MAX_DEPTH = 16;
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m) {
+    // As linhas da matriz, já que o glm guarda as colunas.
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    Frustum frustum;
+    frustum.planes[0] = row[3] + row[0]; // esquerda
+    frustum.planes[1] = row[3] - row[0]; // direita
+    frustum.planes[2] = row[3] + row[1]; // baixo
+    frustum.planes[3] = row[3] - row[1]; // cima
+    frustum.planes[4] = row[3] + row[2]; // perto
+    frustum.planes[5] = row[3] - row[2]; // longe
+    return frustum;
+}
+
+Containment Frustum::classify(const glm::vec3 &min, const glm::vec3 &max) const {
+    Containment result = Containment::Inside;
+    for (const glm::vec4 &plane : planes) {
+        // O vértice da caixa mais à frente e o mais atrás na direção da normal.
+        glm::vec3 front(plane.x >= 0 ? max.x : min.x, plane.y >= 0 ? max.y : min.y,
+                        plane.z >= 0 ? max.z : min.z);
+        glm::vec3 back(plane.x >= 0 ? min.x : max.x, plane.y >= 0 ? min.y : max.y,
+                       plane.z >= 0 ? min.z : max.z);
+        glm::vec3 normal(plane.x, plane.y, plane.z);
+
+        if (glm::dot(normal, front) + plane.w < 0)
+            return Containment::Outside;
+        if (glm::dot(normal, back) + plane.w < 0)
+            result = Containment::Intersects;
+    }
+    return result;
+}
+
+void QuadTree::build(const std::vector<glm::vec3> &points, float radius, float height) {
+    positions = points;
+    item_radius = radius;
+    item_height = height;
+
+    cells.clear();
+    items.resize(points.size());
+    point_cell.resize(points.size());
+    for (int i = 0; i < (int)points.size(); i++)
+        items[i] = i;
+
+    if (points.empty())
+        return;
+
+    cells.push_back(Cell{glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, -1, -1, 0, (int)points.size()});
+    split(0, 0);
+}
+
+/// Calcula os limites da célula `c` e a subdivide enquanto tiver pontos demais.
+void QuadTree::split(int c, int depth) {
+    int begin = cells[c].begin;
+    int end = cells[c].end;
+
+    glm::vec3 min(1.0f / 0.0f);
+    glm::vec3 max(-1.0f / 0.0f);
+    for (int i = begin; i < end; i++) {
+        min = glm::min(min, positions[items[i]]);
+        max = glm::max(max, positions[items[i]]);
+        point_cell[items[i]] = c;
+    }
+    cells[c].min = min - glm::vec3(item_radius, 0.0f, item_radius);
+    cells[c].max = max + glm::vec3(item_radius, item_height, item_radius);
+
+    if (end - begin <= LEAF_SIZE || depth >= MAX_DEPTH)
+        return;
+
+    // Particiona os pontos nos quatro quadrantes em torno do centro.
+    glm::vec3 center = (min + max) / 2.0f;
+    auto first = items.begin() + begin;
+    auto last = items.begin() + end;
+    auto mid = std::partition(first, last, [&](int p) { return positions[p].x < center.x; });
+    auto low = std::partition(first, mid, [&](int p) { return positions[p].z < center.z; });
+    auto high = std::partition(mid, last, [&](int p) { return positions[p].z < center.z; });
+
+    int bounds[5] = {begin, (int)(low - items.begin()), (int)(mid - items.begin()),
+                     (int)(high - items.begin()), end};
+
+    int first_child = cells.size();
+    cells[c].first_child = first_child;
+    for (int k = 0; k < 4; k++)
+        cells.push_back(
+            Cell{glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, -1, c, bounds[k], bounds[k + 1]});
+    for (int k = 0; k < 4; k++)
+        split(first_child + k, depth + 1);
+}
+
+void QuadTree::setReach(int point, float reach) {
+    for (int c = point_cell[point]; c != -1; c = cells[c].parent) {
+        if (cells[c].reach >= reach)
+            break;
+        cells[c].reach = reach;
+    }
+}
+
+size_t QuadTree::memoryUsage() const {
+    return cells.capacity() * sizeof(Cell) + items.capacity() * sizeof(int) +
+           point_cell.capacity() * sizeof(int) + positions.capacity() * sizeof(glm::vec3);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file spatial.h
+ * Estruturas espaciais usadas para descartar o que está fora da câmera.
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/// Resultado do teste de uma caixa contra o frustum.
+enum class Containment { Outside, Intersects, Inside };
+
+/// Os seis planos do volume de visão da câmera.
+struct Frustum {
+    /// Planos na forma (normal, d), com a normal apontando para dentro do volume.
+    glm::vec4 planes[6];
+
+    /// Extrai os planos de uma matriz `projection * view` (método de Gribb/Hartmann).
+    static Frustum fromMatrix(const glm::mat4 &view_projection);
+
+    /// Classifica a caixa alinhada aos eixos [min, max] em relação ao frustum.
+    Containment classify(const glm::vec3 &min, const glm::vec3 &max) const;
+};
+
+/// Quadtree sobre as posições dos nós no plano XZ.
+///
+/// Cada célula guarda um intervalo contíguo de `items`, de forma que uma célula inteiramente
+/// dentro do frustum é visitada sem testar ponto a ponto.
+class QuadTree {
+  public:
+    /// Reconstrói a árvore. `radius` é a meia-extensão do objeto desenhado em cada ponto e
+    /// `height` a sua altura acima do plano.
+    void build(const std::vector<glm::vec3> &points, float radius, float height);
+
+    /// Define o alcance da aresta que parte do ponto `point`, atualizando as células acima dele.
+    void setReach(int point, float reach);
+
+    /// Memória usada pela árvore, em bytes.
+    size_t memoryUsage() const;
+
+    /// Visita os pontos cujo objeto pode estar dentro do frustum.
+    ///
+    /// Com `use_reach`, as células são expandidas pelo alcance das arestas que partem delas, e
+    /// os pontos em células parcialmente visíveis são todos visitados, cabendo a quem chama
+    /// testar a aresta.
+    template <typename F> void query(const Frustum &frustum, bool use_reach, F &&visit) const {
+        if (!cells.empty())
+            queryCell(0, frustum, use_reach, visit);
+    }
+
+  private:
+    struct Cell {
+        glm::vec3 min;
+        glm::vec3 max;
+        /// Maior alcance de uma aresta que parte de um ponto desta célula.
+        float reach;
+        /// Índice da primeira das quatro células filhas, ou -1 numa folha.
+        int first_child;
+        int parent;
+        /// Intervalo [begin, end) em `items`.
+        int begin;
+        int end;
+    };
+
+    std::vector<Cell> cells;
+    /// Índices dos pontos, agrupados por célula.
+    std::vector<int> items;
+    /// A folha que contém cada ponto.
+    std::vector<int> point_cell;
+    std::vector<glm::vec3> positions;
+    float item_radius = 0.0f;
+    float item_height = 0.0f;
+
+    void split(int cell, int depth);
+
+    template <typename F>
+    void queryCell(int c, const Frustum &frustum, bool use_reach, F &visit) const {
+        const Cell &cell = cells[c];
+        glm::vec3 pad = use_reach ? glm::vec3(cell.reach, 0.0f, cell.reach) : glm::vec3(0.0f);
+        Containment containment = frustum.classify(cell.min - pad, cell.max + pad);
+        if (containment == Containment::Outside)
+            return;
+
+        if (containment == Containment::Inside) {
+            for (int i = cell.begin; i < cell.end; i++)
+                visit(items[i]);
+            return;
+        }
+
+        if (cell.first_child != -1) {
+            for (int k = 0; k < 4; k++)
+                queryCell(cell.first_child + k, frustum, use_reach, visit);
+            return;
+        }
+
+        for (int i = cell.begin; i < cell.end; i++) {
+            int p = items[i];
+            if (use_reach) {
+                visit(p);
+                continue;
+            }
+            glm::vec3 min = positions[p] - glm::vec3(item_radius, 0.0f, item_radius);
+            glm::vec3 max = positions[p] + glm::vec3(item_radius, item_height, item_radius);
+            if (frustum.classify(min, max) != Containment::Outside)
+                visit(p);
+        }
+    }
+};
@@ -0,0 +1,194 @@
+/**
+ * @file trace.cpp
+ * Registro de intervalos de tempo, salvos no formato de trace do Chrome.
+ */
+
+#include "trace.h"
+
+#ifdef PRIM_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/// Um intervalo registrado.
+struct TraceEvent {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+/// Uma posição do anel.
+///
+/// `seq` é 2 * i + 1 enquanto o intervalo i é escrito e 2 * i + 2 depois, de forma que quem lê
+/// de outro thread sabe se copiou o intervalo que queria inteiro, sem que o escritor espere.
+struct TraceSlot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> duration_ns{0};
+};
+
+/// Os intervalos de um thread, ou de uma trilha de traceRecordMs.
+///
+/// Só um thread escreve; `head` conta os intervalos já escritos, e é publicado depois de
+/// cada escrita para que traceFlush possa ler de outro thread.
+struct TraceRing {
+    static const size_t CAPACITY = 1 << 16;
+
+    TraceSlot slots[CAPACITY];
+    std::atomic<uint64_t> head{0};
+    int tid;
+    std::atomic<const char *> name{nullptr};
+    /// Se é uma trilha, e não o anel de um thread.
+    bool track = false;
+};
+
+/// Todos os anéis já criados. Os anéis não são liberados quando o seu thread termina, para que
+/// os intervalos dele ainda sejam salvos.
+static std::mutex rings_mutex;
+static std::vector<TraceRing *> rings;
+
+/// Cria um anel e o adiciona a `rings`, que já precisa estar travado.
+static TraceRing *addRing() {
+    TraceRing *ring = new TraceRing;
+    ring->tid = rings.size() + 1;
+    rings.push_back(ring);
+    // O primeiro thread a registrar algo salva o trace ao sair.
+    if (rings.size() == 1)
+        atexit(traceFlush);
+    return ring;
+}
+
+static TraceRing *registerRing() {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    return addRing();
+}
+
+static TraceRing &threadRing() {
+    static thread_local TraceRing *ring = registerRing();
+    return *ring;
+}
+
+/// O anel da trilha `name`, criado no primeiro uso.
+static TraceRing &trackRing(const char *name) {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (TraceRing *ring : rings) {
+        if (ring->track && strcmp(ring->name.load(), name) == 0)
+            return *ring;
+    }
+    TraceRing *ring = addRing();
+    ring->track = true;
+    ring->name = name;
+    return *ring;
+}
+
+uint64_t traceNow() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void record(TraceRing &ring, const char *name, uint64_t start_ns, uint64_t end_ns) {
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    TraceSlot &slot = ring.slots[head % TraceRing::CAPACITY];
+    slot.seq.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.duration_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+    slot.seq.store(2 * head + 2, std::memory_order_release);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void traceRecord(const char *name, uint64_t start_ns) {
+    record(threadRing(), name, start_ns, traceNow());
+}
+
+void traceRecordMs(const char *name, double start_ms, double end_ms, const char *track) {
+    TraceRing &ring = track ? trackRing(track) : threadRing();
+    // perfNow() usa o mesmo relógio, em milissegundos.
+    record(ring, name, (uint64_t)(start_ms * 1e6), (uint64_t)(end_ms * 1e6));
+}
+
+void traceThreadName(const char *name) { threadRing().name = name; }
+
+/// Copia o intervalo `i` do anel, ou retorna false se ele já foi sobrescrito ou está sendo.
+static bool readEvent(const TraceRing &ring, uint64_t i, TraceEvent &event) {
+    const TraceSlot &slot = ring.slots[i % TraceRing::CAPACITY];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * i + 2)
+        return false;
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+    event.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == seq;
+}
+
+/// Escreve uma string JSON, escapando o que for preciso.
+static void writeJsonString(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', out);
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+void traceFlush() {
+    const char *path = getenv("PRIM_TRACE_FILE");
+    if (!path)
+        path = "prim_trace.json";
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    size_t total = 0;
+    std::vector<TraceEvent> events;
+    for (TraceRing *ring : rings) {
+        const char *name = ring->name.load();
+        if (name) {
+            fprintf(out, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %d, ",
+                    first ? "" : ",\n", ring->tid);
+            fprintf(out, "\"args\": {\"name\": ");
+            writeJsonString(out, name);
+            fprintf(out, "}}");
+            first = false;
+        }
+
+        // Copia os intervalos, descartando os que o thread sobrescreveu durante a cópia.
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > TraceRing::CAPACITY ? head - TraceRing::CAPACITY : 0;
+        events.clear();
+        for (uint64_t i = begin; i < head; i++) {
+            TraceEvent event;
+            if (readEvent(*ring, i, event))
+                events.push_back(event);
+        }
+
+        for (size_t i = 0; i < events.size(); i++) {
+            const TraceEvent &event = events[i];
+            fprintf(out, "%s{\"ph\": \"X\", \"name\": ", first ? "" : ",\n");
+            writeJsonString(out, event.name);
+            fprintf(out, ", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", ring->tid,
+                    event.start_ns / 1e3, event.duration_ns / 1e3);
+            first = false;
+        }
+        total += events.size();
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    fprintf(stderr, "Saved %zu trace events to %s\n", total, path);
+}
+
+#endif
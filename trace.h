@@ -0,0 +1,73 @@
+/**
+ * @file trace.h
+ * Registro de intervalos de tempo, salvos no formato de trace do Chrome.
+ *
+ * Só existe quando compilado com PRIM_TRACE (`make TRACE=1`); sem ele, TRACE_SCOPE e
+ * TRACE_EVENT não geram código e traceFlush não faz nada.
+ *
+ * Cada thread guarda os seus intervalos num anel próprio, sem locks: os mais antigos são
+ * sobrescritos quando ele enche. traceFlush escreve os anéis de todos os threads em
+ * `$PRIM_TRACE_FILE` (padrão: `prim_trace.json`), que pode ser aberto no Perfetto
+ * (ui.perfetto.dev) ou no chrome://tracing. Isso é feito ao sair do programa e com a tecla `t`.
+ *
+ * Intervalos que não são de um thread, como os tempos de GPU, vão para trilhas com nome próprio
+ * (TRACE_TRACK_EVENT), cada uma com o seu anel.
+ */
+
+#pragma once
+
+#ifdef PRIM_TRACE
+
+#include <stdint.h>
+
+/// Registra o intervalo `name`, de `start_ns` até agora, no anel do thread atual.
+///
+/// `name` precisa continuar válido até o trace ser salvo, como um literal.
+void traceRecord(const char *name, uint64_t start_ns);
+
+/// Registra o intervalo `name` entre os tempos `start_ms` e `end_ms` de perfNow().
+///
+/// Com `track`, o intervalo vai para a trilha com esse nome em vez da do thread atual. Cada trilha
+/// deve receber intervalos de um thread só.
+void traceRecordMs(const char *name, double start_ms, double end_ms, const char *track = nullptr);
+
+/// Tempo atual do relógio do trace, em nanossegundos.
+uint64_t traceNow();
+
+/// Dá um nome ao thread atual no trace.
+void traceThreadName(const char *name);
+
+/// Salva os intervalos registrados até agora por todos os threads.
+void traceFlush();
+
+/// Registra o intervalo entre a sua criação e a sua destruição.
+class TraceScope {
+  public:
+    explicit TraceScope(const char *name) : name(name), start(traceNow()) {}
+    ~TraceScope() { traceRecord(name, start); }
+
+  private:
+    const char *name;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+/// Registra o tempo até o fim do escopo atual com o nome `name`.
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+/// Registra o intervalo `name` entre dois tempos de perfNow().
+#define TRACE_EVENT(name, start_ms, end_ms) traceRecordMs(name, start_ms, end_ms)
+/// Registra o intervalo `name` entre dois tempos de perfNow() na trilha `track`.
+#define TRACE_TRACK_EVENT(track, name, start_ms, end_ms)                                          \
+    traceRecordMs(name, start_ms, end_ms, track)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_EVENT(name, start_ms, end_ms) ((void)0)
+#define TRACE_TRACK_EVENT(track, name, start_ms, end_ms) ((void)0)
+
+inline void traceThreadName(const char *) {}
+inline void traceFlush() {}
+
+#endif
@@ -8,23 +8,227 @@
  */
 
 #include "utils.h"
+#include "trace.h"
 
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+/** Magic number and version of the program binary cache files. */
+static const char PROGRAM_CACHE_MAGIC[4] = {'P', 'S', 'H', 'B'};
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+/** Header of a program binary cache file, followed by the binary. */
+struct ProgramCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    /** Hash of the sources and of the driver that produced the binary. */
+    uint64_t key;
+    /** Format of the binary, as returned by glGetProgramBinary. */
+    uint32_t format;
+    uint32_t length;
+};
+
+/**
+ * Hash (FNV-1a) of a string, including the terminating null, chained with a previous hash.
+ */
+static uint64_t hashString(uint64_t hash, const char *text)
+{
+    if (!text)
+        text = "";
+    do
+    {
+        hash = (hash ^ (unsigned char)*text) * 0x100000001b3ull;
+    } while (*text++);
+    return hash;
+}
+
+/**
+ * Whether the driver can save and load program binaries.
+ */
+static bool programBinarySupported()
+{
+    if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1)
+        return false;
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+/**
+ * Directory of the program binary cache: $PRIM_SHADER_CACHE, or a "prim-shaders" directory
+ * in the user cache directory. Created if missing.
+ */
+static std::string programCacheDirectory()
+{
+    std::string dir;
+    if (const char *env = getenv("PRIM_SHADER_CACHE"))
+        dir = env;
+#ifdef _WIN32
+    else if (const char *local = getenv("LOCALAPPDATA"))
+        dir = std::string(local) + "\\prim-shaders";
+    else
+        dir = "prim-shaders";
+    _mkdir(dir.c_str());
+#else
+    else if (const char *xdg = getenv("XDG_CACHE_HOME"))
+        dir = std::string(xdg) + "/prim-shaders";
+    else if (const char *home = getenv("HOME"))
+    {
+        std::string cache = std::string(home) + "/.cache";
+        mkdir(cache.c_str(), 0755);
+        dir = cache + "/prim-shaders";
+    }
+    else
+        dir = "prim-shaders";
+    mkdir(dir.c_str(), 0755);
+#endif
+    return dir;
+}
+
+/**
+ * Key of a program in the cache.
+ *
+ * A binary is only valid for the same sources and the same driver, so the key hashes both.
+ */
+static uint64_t programCacheKey(const char *vertex_code, const char *fragment_code)
+{
+    uint64_t key = 0xcbf29ce484222325ull ^ PROGRAM_CACHE_VERSION;
+    key = hashString(key, vertex_code);
+    key = hashString(key, fragment_code);
+    key = hashString(key, (const char *)glGetString(GL_VENDOR));
+    key = hashString(key, (const char *)glGetString(GL_RENDERER));
+    key = hashString(key, (const char *)glGetString(GL_VERSION));
+    return key;
+}
+
+static std::string programCachePath(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return programCacheDirectory() + name;
+}
+
+/**
+ * Load a program from the binary cache.
+ *
+ * @return The program, or 0 if there is no cached binary or the driver rejected it.
+ */
+static int loadProgramBinary(const std::string &path, uint64_t key)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return 0;
+
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) == 0 &&
+              header.version == PROGRAM_CACHE_VERSION && header.key == key;
+    if (ok)
+    {
+        // A truncated or corrupt file is a miss, not a huge allocation.
+        long start = ftell(file);
+        ok = start >= 0 && fseek(file, 0, SEEK_END) == 0 &&
+             ftell(file) - start == (long)header.length && fseek(file, start, SEEK_SET) == 0;
+    }
+    if (ok)
+    {
+        binary.resize(header.length);
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!ok)
+        return 0;
+
+    int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), binary.size());
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // The driver was updated or does not accept its own binary anymore.
+        glDeleteProgram(program);
+        remove(path.c_str());
+        return 0;
+    }
+    return program;
+}
+
+/**
+ * Save the binary of a linked program to the cache.
+ *
+ * The file is written to a temporary name and renamed, so a partial file is never read.
+ */
+static void saveProgramBinary(int program, const std::string &path, uint64_t key)
+{
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = length;
+
+    std::string temp = path + ".tmp";
+    FILE *file = fopen(temp.c_str(), "wb");
+    if (!file)
+        return;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(binary.data(), 1, length, file) == (size_t)length;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0)
+        remove(temp.c_str());
+}
 
 /** 
  * Create program.
  *
  * Creates a program from given shader codes.
  *
+ * When the driver supports program binaries, the linked program is saved to a cache and
+ * loaded from it on the next runs, skipping the compilation.
+ *
  * @param vertex_code String with code for vertex shader.
  * @param fragment_code String with code for fragment shader.
  * @return Compiled program.
  */
 int createShaderProgram(const char *vertex_code, const char *fragment_code)
 {
+    TRACE_SCOPE("createShaderProgram");
 	
     int success;
     char error[512];
 
+    bool cacheable = programBinarySupported();
+    uint64_t key = 0;
+    std::string cache_path;
+    if (cacheable)
+    {
+        key = programCacheKey(vertex_code, fragment_code);
+        cache_path = programCachePath(key);
+        int program = loadProgramBinary(cache_path, key);
+        if (program)
+            return program;
+    }
+
     // Request a program and shader slots from GPU
     int program  = glCreateProgram();
     int vertex   = glCreateShader(GL_VERTEX_SHADER);
@@ -56,8 +260,10 @@ int createShaderProgram(const char *vertex_code, const char *fragment_code)
     glAttachShader(program, fragment);
 
     // Build program
+    if (cacheable)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
-    glGetShaderiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (!success)
     {
 	glGetProgramInfoLog(program, 512, NULL, error);
@@ -70,5 +276,8 @@ int createShaderProgram(const char *vertex_code, const char *fragment_code)
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 
+    if (cacheable && success)
+        saveProgramBinary(program, cache_path, key);
+
     return program;
 }
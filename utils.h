@@ -15,7 +15,9 @@
 /** 
  * Create program.
  *
- * Creates a program from given shader codes.
+ * Creates a program from given shader codes. Linked programs are kept in a binary cache,
+ * in $PRIM_SHADER_CACHE or in the user cache directory, and loaded from it when the sources
+ * and the driver did not change.
  *
  * @param vertex_code String with code for vertex shader.
  * @param fragment_code String with code for fragment shader.